@@ -0,0 +1,166 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+
+// implemented by final_v5.cpp
+bool arena_setup(int board_size, const std::string options[2]);
+void arena_game(const std::string options[2], int opening, uint64_t seed, int scores[2], long long think_us[2], int moves[2]);
+
+// self play between two option sets of final_v5, e.g.
+//   arena --games 10000 --a "--eval final --depth 4" --b "--depth 4"
+// games come in pairs on the same random opening with the sides swapped, so neither option set
+// profits from a lucky start or from moving first.
+struct MatchTotals {
+    int games = 0;
+    int wins = 0;      // for a
+    int draws = 0;
+    int losses = 0;
+    long long margin = 0;  // boxes of a minus boxes of b, summed over the games
+    long long think_us[2] = {0, 0};
+    long long moves[2] = {0, 0};
+};
+
+double elo(double score)
+{
+    score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+    return -400 * std::log10(1 / score - 1);
+}
+
+int main(int argc, char* argv[])
+{
+    int games = 1000;
+    int board_size = 5;
+    int opening = 6;
+    int jobs = std::max(1u, std::thread::hardware_concurrency());
+    uint64_t seed = 1;
+    // small tables by default, there is a pair of them per thread
+    std::string options[2] = {"--hash 4 --depth 4", "--hash 4 --depth 4"};
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--games" && has_value)
+        {
+            games = std::stoi(argv[++i]);
+        }
+        else if (arg == "--size" && has_value)
+        {
+            board_size = std::stoi(argv[++i]);
+        }
+        else if (arg == "--opening" && has_value)
+        {
+            // random safe lines before the engines take over
+            opening = std::stoi(argv[++i]);
+        }
+        else if (arg == "--jobs" && has_value)
+        {
+            jobs = std::max(1, std::stoi(argv[++i]));
+        }
+        else if (arg == "--seed" && has_value)
+        {
+            seed = std::stoull(argv[++i]);
+        }
+        else if (arg == "--a" && has_value)
+        {
+            options[0] = "--hash 4 " + std::string(argv[++i]);
+        }
+        else if (arg == "--b" && has_value)
+        {
+            options[1] = "--hash 4 " + std::string(argv[++i]);
+        }
+        else
+        {
+            std::cerr << "arena: unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (!arena_setup(board_size, options))
+    {
+        return 1;
+    }
+
+    std::atomic<int> next_game(0);
+    std::mutex totals_mutex;
+    MatchTotals totals;
+    std::vector<double> results(games);  // score of a in every game, for the error bars
+    auto start = std::chrono::steady_clock::now();
+    auto play = [&]() {
+        int game;
+        while ((game = next_game++) < games)
+        {
+            // even games give a the first move, odd ones replay the same opening with b first
+            bool a_first = game % 2 == 0;
+            std::string sides[2] = {a_first ? options[0] : options[1], a_first ? options[1] : options[0]};
+            int scores[2];
+            long long think_us[2];
+            int moves[2];
+            arena_game(sides, opening, seed * 1000003 + game / 2, scores, think_us, moves);
+
+            int a = a_first ? 0 : 1;
+            int b = 1 - a;
+            std::lock_guard<std::mutex> lock(totals_mutex);
+            totals.games++;
+            totals.margin += scores[a] - scores[b];
+            if (scores[a] > scores[b])
+            {
+                totals.wins++;
+                results[game] = 1;
+            }
+            else if (scores[a] < scores[b])
+            {
+                totals.losses++;
+                results[game] = 0;
+            }
+            else
+            {
+                totals.draws++;
+                results[game] = 0.5;
+            }
+            totals.think_us[0] += think_us[a];
+            totals.think_us[1] += think_us[b];
+            totals.moves[0] += moves[a];
+            totals.moves[1] += moves[b];
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 0; i < jobs; ++i)
+    {
+        workers.emplace_back(play);
+    }
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double n = totals.games;
+    double mean = (totals.wins + 0.5 * totals.draws) / n;
+    double variance = 0;
+    for (double r : results)
+    {
+        variance += (r - mean) * (r - mean);
+    }
+    variance /= std::max(1.0, n - 1);
+    double error = 1.96 * std::sqrt(variance / n);
+
+    std::printf("a: %s\nb: %s\n", options[0].c_str(), options[1].c_str());
+    std::printf("games %d on %dx%d, %d jobs, %.1f s\n", totals.games, board_size, board_size, jobs, seconds);
+    std::printf("a wins %d, draws %d, losses %d, score %.1f%%\n", totals.wins, totals.draws, totals.losses, 100 * mean);
+    std::printf("mean margin %+.2f boxes for a\n", totals.margin / n);
+    std::printf("elo %+.1f (95%% %+.1f .. %+.1f)\n", elo(mean), elo(mean - error), elo(mean + error));
+    for (int side = 0; side < 2; ++side)
+    {
+        std::printf("%c: %.3f ms per move over %lld moves\n", "ab"[side],
+                    totals.moves[side] ? totals.think_us[side] / 1000.0 / totals.moves[side] : 0.0, totals.moves[side]);
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// implemented by the engine this is linked against (final_v5.cpp or final.cpp)
+void bench_load(int board_size);
+std::string bench_search(int depth, uint64_t& nodes);
+
+// positions file: a "position <name> <depth> <board size>" line followed by the turn input the
+// bot would get for it (scores, number of open boxes, one line per open box). # starts a comment.
+int main(int argc, char* argv[])
+{
+    std::string path = BENCH_POSITIONS;
+    int depth_override = 0;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg == "--depth" && i + 1 < argc)
+        {
+            // search every position to this depth instead of the one in the file
+            depth_override = std::stoi(argv[++i]);
+        }
+        else
+        {
+            path = arg;
+        }
+    }
+
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cerr << "bench: can't open " << path << std::endl;
+        return 1;
+    }
+
+    std::printf("%-20s %5s %12s %10s %12s  %s\n", "position", "depth", "nodes", "ms", "nodes/sec", "move");
+    uint64_t total_nodes = 0;
+    double total_ms = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream header(line);
+        std::string tag, name;
+        int depth = 0, board_size = 0;
+        if (!(header >> tag) || tag != "position")
+        {
+            continue;
+        }
+        header >> name >> depth >> board_size;
+        if (depth_override > 0)
+        {
+            depth = depth_override;
+        }
+
+        // the turn input is the scores line, the box count and then that many box lines
+        std::string turn_input, scores, count;
+        std::getline(file, scores);
+        std::getline(file, count);
+        turn_input = scores + "\n" + count + "\n";
+        for (int i = 0, n = std::stoi(count); i < n && std::getline(file, line); ++i)
+        {
+            turn_input += line + "\n";
+        }
+
+        std::istringstream input(turn_input);
+        std::streambuf* saved = std::cin.rdbuf(input.rdbuf());
+        bench_load(board_size);
+        std::cin.rdbuf(saved);
+
+        uint64_t nodes = 0;
+        auto start = std::chrono::steady_clock::now();
+        std::string move = bench_search(depth, nodes);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        total_nodes += nodes;
+        total_ms += ms;
+        std::printf("%-20s %5d %12llu %10.1f %12.0f  %s\n", name.c_str(), depth, (unsigned long long)nodes, ms,
+                    ms > 0 ? nodes * 1000.0 / ms : 0.0, move.c_str());
+    }
+    std::printf("%-20s %5s %12llu %10.1f %12.0f\n", "total", "", (unsigned long long)total_nodes, total_ms,
+                total_ms > 0 ? total_nodes * 1000.0 / total_ms : 0.0);
+    return 0;
+}
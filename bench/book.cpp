@@ -0,0 +1,61 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdio>
+
+// implemented by final_v5.cpp
+size_t book_build(int board_size, int plies, int depth, int threads, const std::string& path);
+
+// builds an opening book for final_v5 --book, e.g.
+//   book --size 5 --plies 2 --depth 7 --out book5.bin
+// every position with up to --plies lines on the board is searched to --depth, one per symmetry
+// class, so the book size grows with the number of line sets divided by the symmetries.
+int main(int argc, char* argv[])
+{
+    int board_size = 5;
+    int plies = 2;
+    int depth = 6;
+    int threads = 1;
+    std::string path = "book.bin";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--size" && has_value)
+        {
+            board_size = std::stoi(argv[++i]);
+        }
+        else if (arg == "--plies" && has_value)
+        {
+            plies = std::stoi(argv[++i]);
+        }
+        else if (arg == "--depth" && has_value)
+        {
+            depth = std::stoi(argv[++i]);
+        }
+        else if (arg == "--threads" && has_value)
+        {
+            threads = std::stoi(argv[++i]);
+        }
+        else if (arg == "--out" && has_value)
+        {
+            path = argv[++i];
+        }
+        else
+        {
+            std::cerr << "book: unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t entries = book_build(board_size, plies, depth, threads, path);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (entries == 0)
+    {
+        std::cerr << "book: can't write " << path << std::endl;
+        return 1;
+    }
+    std::printf("%zu positions on %dx%d to depth %d in %.1f s -> %s\n", entries, board_size, board_size, depth, seconds, path.c_str());
+    return 0;
+}
@@ -0,0 +1,60 @@
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+
+// implemented by final_v5.cpp
+int side_masks_check(int board_size, int boards, uint64_t seed);
+
+// compares the avx2 side count kernel of final_v5 with the scalar one on random boards of every
+// size from --min-size to --max-size, e.g.
+//   side_masks_check --boards 10000
+// the vector loop only runs on boards with eight box rows or more, which the bench and the solver
+// check never reach. exits with 77 (skipped) when the cpu has no avx2.
+int main(int argc, char* argv[])
+{
+    int min_size = 2;
+    int max_size = 25;
+    int boards = 10000;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--min-size" && has_value)
+        {
+            min_size = std::stoi(argv[++i]);
+        }
+        else if (arg == "--max-size" && has_value)
+        {
+            max_size = std::stoi(argv[++i]);
+        }
+        else if (arg == "--boards" && has_value)
+        {
+            boards = std::stoi(argv[++i]);
+        }
+        else if (arg == "--seed" && has_value)
+        {
+            seed = std::stoull(argv[++i]);
+        }
+        else
+        {
+            std::cerr << "side_masks_check: unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    int failed = 0;
+    for (int size = min_size; size <= max_size; ++size)
+    {
+        int mismatches = side_masks_check(size, boards, seed + size);
+        if (mismatches < 0)
+        {
+            std::printf("no avx2 on this cpu, nothing to compare\n");
+            return 77;
+        }
+        failed += mismatches;
+    }
+    std::printf("%d boards on each size %d to %d compared, %d mismatches\n", boards, min_size, max_size, failed);
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// implemented by final_v5.cpp
+int solver_check(int board_size, int positions, int max_free, uint64_t seed, int& failed);
+
+// compares the endgame solver of final_v5 with a brute force search on random endgames, e.g.
+//   solver_check --size 4 --positions 500
+// fails when the solver gets a value wrong or picks a line that doesn't reach it. --max-free
+// bounds the free lines of a position, the brute force doubles in time with each one.
+int main(int argc, char* argv[])
+{
+    int board_size = 3;
+    int positions = 1000;
+    int max_free = 16;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--size" && has_value)
+        {
+            board_size = std::stoi(argv[++i]);
+        }
+        else if (arg == "--positions" && has_value)
+        {
+            positions = std::stoi(argv[++i]);
+        }
+        else if (arg == "--max-free" && has_value)
+        {
+            max_free = std::stoi(argv[++i]);
+        }
+        else if (arg == "--seed" && has_value)
+        {
+            seed = std::stoull(argv[++i]);
+        }
+        else
+        {
+            std::cerr << "solver_check: unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    int failed = 0;
+    int compared = solver_check(board_size, positions, max_free, seed, failed);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%d of %d positions on %dx%d compared, %d mismatches, %.1f s\n", compared, positions, board_size,
+                board_size, failed, seconds);
+    return failed == 0 && compared > 0 ? 0 : 1;
+}
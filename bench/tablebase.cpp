@@ -0,0 +1,46 @@
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdio>
+
+// implemented by final_v5.cpp
+size_t tablebase_build(int max_boxes, const std::string& path);
+
+// builds the chain and loop tablebase for final_v5 --tablebase, e.g.
+//   tablebase --boxes 40 --out components.bin
+// holds the endgame value of every set of closed chains and loops with at most --boxes boxes in
+// total. the file works for every board size.
+int main(int argc, char* argv[])
+{
+    int max_boxes = 40;
+    std::string path = "components.bin";
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--boxes" && has_value)
+        {
+            max_boxes = std::stoi(argv[++i]);
+        }
+        else if (arg == "--out" && has_value)
+        {
+            path = argv[++i];
+        }
+        else
+        {
+            std::cerr << "tablebase: unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    size_t entries = tablebase_build(max_boxes, path);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (entries == 0)
+    {
+        std::cerr << "tablebase: can't write " << path << std::endl;
+        return 1;
+    }
+    std::printf("%zu component sets up to %d boxes in %.1f s -> %s\n", entries, max_boxes, seconds, path.c_str());
+    return 0;
+}
@@ -4,6 +4,7 @@
 #include <cmath>
 #include <algorithm>
 #include <limits>
+#include <cstdint>
 
 using namespace std;
 
@@ -12,6 +13,8 @@ const int B = 1;
 int rows = 0, columns = 0;
 int bot_score = 0;
 int opp_score = 0;
+int search_depth = 3;
+uint64_t nodes_searched = 0;
 
 enum State { 
     NO_OWNER = -1,
@@ -40,6 +43,7 @@ void undo_move(const Move& move);
 bool game_state();
 double minimax(int depth, double alpha, double beta, bool maxim);
 Move winning_move();
+Move search_root(const std::vector<Move>& moves, int depth);
 string translate(const Move& move);
 void parse_turn_input();
 int count_sides(int r, int c);
@@ -201,6 +205,7 @@ bool game_state()
 
 double minimax(int depth, double alpha, double beta, bool maxim)
 {
+    nodes_searched++;
     if (depth == 0 || game_state())
     {
         return eval_board();
@@ -320,13 +325,17 @@ Move winning_move()
         return safe_moves[0];
     }
     
-    int depth = 3;
-    Move best_move = available_moves[0];
+    return search_root(available_moves, search_depth);
+}
+
+Move search_root(const std::vector<Move>& moves, int depth)
+{
+    Move best_move = moves[0];
     double best_score = -numeric_limits<double>::infinity();
     double alpha = -numeric_limits<double>::infinity();
     double beta = numeric_limits<double>::infinity();
 
-    for (const Move& move : available_moves)
+    for (const Move& move : moves)
     {
         int boxed = apply_move(move);
         double eval = (boxed > 0) ? minimax(depth - 1, alpha, beta, true) : minimax(depth - 1, alpha, beta, false);
@@ -429,6 +438,31 @@ void parse_turn_input()
     }
 }
 
+// same bench hooks as final_v5.cpp, so bench/bench.cpp can time both engines on one position set
+void bench_load(int board_size)
+{
+    rows = board_size + 1;
+    columns = board_size + 1;
+    default_arr();
+    parse_turn_input();
+}
+
+std::string bench_search(int depth, uint64_t& nodes)
+{
+    turn = AI;
+    nodes_searched = 0;
+    std::vector<Move> available_moves = move_gen();
+    nodes = 0;
+    if (available_moves.empty())
+    {
+        return "-";
+    }
+    Move best_move = search_root(available_moves, depth);
+    nodes = nodes_searched;
+    return translate(best_move);
+}
+
+#ifndef DOTS_NO_MAIN
 int main()
 {
     ios_base::sync_with_stdio(false);
@@ -455,4 +489,5 @@ int main()
         std::cout << output_move << std::endl;
     }
     return 0;
-}
\ No newline at end of file
+}
+#endif
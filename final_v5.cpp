@@ -4,23 +4,114 @@
 #include <cmath>
 #include <algorithm>
 #include <limits>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <sstream>
+#include <iterator>
+#include <type_traits>
+#include <fstream>
+#include <cstring>
+#include <unordered_set>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 using namespace std;
 
 const int A = 10;
 const int B = 1;
 int rows = 0, columns = 0;
-int bot_score = 0;
-int opp_score = 0;
 
 enum State { 
     NO_OWNER = -1,
     HUMAN = 0, 
     AI = 1 
 };
-std::vector<std::vector<bool>> horizontal_lines;
-std::vector<std::vector<bool>> vertical_lines;
-std::vector<std::vector<int>> box_owners;
+
+// bitboard layout: every row of lines is packed into one 32 bit word. horizontal rows live in
+// slots [0, rows), vertical rows start at V_BASE. an edge id is slot * ROW_BITS + column and a
+// box id is row * ROW_BITS + column, so box (r, c) is bit c of its row in every table below.
+const int MAX_DIM = 26; // box columns are labelled 'A'..'Z'
+const int ROW_BITS = 32;
+const int V_BASE = MAX_DIM + 1;
+const int EDGE_SLOTS = V_BASE + MAX_DIM;
+const int MAX_EDGE_ID = EDGE_SLOTS * ROW_BITS;
+const int MAX_BOX_ID = MAX_DIM * ROW_BITS;
+
+struct EdgeSet {
+    uint32_t row[EDGE_SLOTS];
+};
+struct BoxSet {
+    uint32_t row[MAX_DIM];
+};
+
+// board geometry, zobrist keys and symmetries are shared by every search; everything that
+// changes during a game lives in a Board, and everything a search needs besides the position in
+// a SearchContext, so any number of searches or games can run side by side
+uint32_t h_mask = 0, v_mask = 0, box_mask = 0;  // valid bits of a horizontal, vertical and box row
+int edge_boxes[MAX_EDGE_ID][2];                  // boxes touching an edge, -1 when off the board
+int box_edges[MAX_BOX_ID][4];                    // top, bottom, left and right line of a box
+
+// the board size as a template parameter for the search's inner loops. Grid<N> is an N x N board
+// known at compile time, so the row loops run a constant number of times over constant masks;
+// Grid<0> reads the geometry above and covers every other board.
+template <int N>
+struct Grid {
+    static constexpr int rows() { return N + 1; }
+    static constexpr int columns() { return N + 1; }
+    static constexpr uint32_t h_mask() { return (1u << N) - 1; }
+    static constexpr uint32_t v_mask() { return (1u << (N + 1)) - 1; }
+};
+template <>
+struct Grid<0> {
+    static int rows() { return ::rows; }
+    static int columns() { return ::columns; }
+    static uint32_t h_mask() { return ::h_mask; }
+    static uint32_t v_mask() { return ::v_mask; }
+};
+
+// calls f with std::integral_constant<int, N> for the square boards that get their own
+// instantiation of the search, N = 0 for any other board
+template <typename F>
+void dispatch_board_size(F f)
+{
+    switch (rows == columns ? rows - 1 : 0)
+    {
+    case 3: f(std::integral_constant<int, 3>()); break;
+    case 4: f(std::integral_constant<int, 4>()); break;
+    case 5: f(std::integral_constant<int, 5>()); break;
+    case 6: f(std::integral_constant<int, 6>()); break;
+    case 7: f(std::integral_constant<int, 7>()); break;
+    case 8: f(std::integral_constant<int, 8>()); break;
+    case 9: f(std::integral_constant<int, 9>()); break;
+    default: f(std::integral_constant<int, 0>()); break;
+    }
+}
+
+// zobrist hashing: one key per edge plus one for the side to move
+uint64_t zobrist_edge[MAX_EDGE_ID];
+uint64_t zobrist_side = 0;
+
+// board symmetries. sym_edge[k] maps every edge through the k-th rotation or reflection that takes
+// the grid onto itself (k = 0 is the identity) and Board::sym_hash[k] hashes the position seen
+// through it. the table is keyed by the smallest of them, so mirrored and rotated positions share
+// one entry.
+const int MAX_SYMMETRIES = 8;
+int sym_count = 1;
+int sym_edge[MAX_SYMMETRIES][MAX_EDGE_ID];
+int sym_inverse[MAX_SYMMETRIES];
 
 enum LineType { 
     HORIZONTAL, 
@@ -30,510 +121,3267 @@ struct Move {
     int r, c; 
     LineType type; 
 };
-State turn = HUMAN;
 
-void default_arr();
-std::vector<Move> move_gen();
-double eval_board();
-int apply_move(const Move& move);
-void undo_move(const Move& move);
-bool game_state();
-
-double minimax(int depth, double alpha, double beta, bool maxim);
-Move winning_move();
-string translate(const Move& move);
-void parse_turn_input();
-int count_sides(int r, int c);
+// the position, kept up to date by apply_move()/undo_move(). a plain value: copying it hands the
+// position to another search.
+struct Board {
+    EdgeSet lines;                     // drawn lines
+    BoxSet owned[2];                   // completed boxes of each player, indexed by State
+    uint8_t side_count[MAX_BOX_ID];    // sides drawn around every box
+    int sided_boxes[5];                // how many boxes have 0..4 sides
+    BoxSet two_sided;                  // boxes with exactly two sides: a line next to one hands it over
+    BoxSet three_sided;                // boxes with exactly three sides: a line next to one captures
+    uint64_t board_hash;
+    uint64_t sym_hash[MAX_SYMMETRIES];
+    int bot_score;
+    int opp_score;
+    State turn;
+};
+
+enum Bound {
+    BOUND_EXACT,
+    BOUND_LOWER,
+    BOUND_UPPER
+};
+// scores are stored relative to A * (bot_score - opp_score) so an entry stays valid whatever the
+// score was when the position was reached. eval is integer valued, so the score packs into 32 bits.
+struct TTEntry {
+    int score;
+    int depth;
+    int move;
+    int bound;
+    int age;
+};
+// the table is shared by all search threads without locks: check holds key ^ data, so a slot torn
+// by two threads writing at once fails the key test and just reads as a miss
+struct TTSlot {
+    std::atomic<uint64_t> check;
+    std::atomic<uint64_t> data;
+};
+struct TransTable {
+    std::unique_ptr<TTSlot[]> slots;
+    size_t mask = 0;
+    uint8_t age = 0;
+};
+TransTable main_table;
+
+// monte carlo tree. nodes live in one preallocated pool and are handed out by bumping an index, the
+// children of a node side by side. all threads grow the same tree without locks: a node is expanded
+// by whichever thread flips it from MCTS_LEAF to MCTS_EXPANDING first, and publishes its children
+// by storing MCTS_EXPANDED.
+enum MctsState {
+    MCTS_LEAF,
+    MCTS_EXPANDING,
+    MCTS_EXPANDED
+};
+struct MctsNode {
+    int move;                    // line drawn to get here, -1 at the root
+    State mover;                 // who drew it; rewards are counted for this side
+    int first_child;
+    int child_count;
+    std::atomic<int> state;
+    std::atomic<int> visits;     // counted on the way down, so a playout still running reads as a loss
+    std::atomic<int> reward;     // in half points: 2 a win, 1 a draw
+};
+struct MctsTree {
+    std::unique_ptr<MctsNode[]> nodes;
+    int capacity = 0;
+    std::atomic<int> used{0};
+};
+
+// evaluation used at the leaves: final_v5's own, or final.cpp's material minus three sided boxes
+enum EvalProfile {
+    EVAL_V5,
+    EVAL_FINAL
+};
+
+// how a position that needs a search is searched: iterative deepening alpha-beta, or monte carlo
+// tree search, see mcts_search()
+enum SearchEngine {
+    ENGINE_ALPHABETA,
+    ENGINE_MCTS
+};
+
+// everything the command line sets. every search has its own copy, so self play can give each side
+// of a game its own settings
+struct EngineConfig {
+    size_t hash_mb = 64;
+    long long move_time_ms = 1000;
+    long long game_time_ms = 0;  // when set, caps the budget so the whole game fits in that clock
+    int depth_limit = 0;         // when set the search stops after this many plies whatever the clock says
+    int threads = 1;
+    EvalProfile eval = EVAL_V5;
+    SearchEngine engine = ENGINE_ALPHABETA;
+    bool telemetry = false;
+    bool ponder = false;         // keep searching on the opponent's time
+    bool quiescence = true;      // resolve pending captures below the depth limit, see quiesce()
+    bool batch = false;          // analyse a stream of positions instead of playing, see run_batch()
+    std::string book;            // opening book file, see book_load()
+    std::string tablebase;       // component tablebase file, see tablebase_load()
+};
+
+// time control. the search deepens one ply at a time until the budget for this move runs out
+typedef std::chrono::steady_clock Clock;
+
+// search counters, kept per search. they are plain increments and always on; --telemetry prints
+// them after every move as one json line on stderr
+struct SearchStats {
+    uint64_t nodes;          // negamax calls
+    uint64_t qnodes;         // quiesce() calls below the depth limit
+    uint64_t applied;        // apply_move calls made by the search
+    uint64_t expanded;       // nodes that went through their move list
+    uint64_t cutoffs;        // expanded nodes that stopped early on a bound
+    uint64_t first_cutoffs;  // ... already on the first move
+    uint64_t tt_probes;
+    uint64_t tt_hits;
+};
+
+// lazy smp: the extra threads search the same root and share what they find through the table.
+// the move played comes from the deepest iteration any thread finished. what one search shares
+// with its helpers lives here; a helper points at the one of the search it helps.
+struct SearchShared {
+    Clock::time_point deadline;
+    std::atomic<bool> stopped{false};
+    std::mutex mutex;
+    int depth = 0;
+    int move = -1;
+    int score = 0;                 // of that move, in eval_board() units from the ai's view
+    SearchStats helper_stats = {}; // what the helper threads counted this move
+};
+// sizes of the per search buffers
+const int MAX_PLY = 128;
+const int MAX_MOVES = 2 * MAX_DIM * (MAX_DIM + 1);
+const int HISTORY_MAX = 1 << 24;
+
+// search scores stay well inside this, a whole 26x26 board of boxes is under 7000
+const int SCORE_INF = 100000;
+// half width of the root window around the last iteration's score: one box
+const int ASPIRATION_WINDOW = A;
+
+// endgame components, see the endgame solver below
+enum ChainKind {
+    CHAIN,        // path of boxes with a free line to the border at both ends
+    LOOP,         // closed cycle of boxes
+    OPENED,       // path whose first box has three sides, the other end reaches the border
+    OPENED_BOTH   // path with three sided boxes at both ends (an opened loop, or two chains met)
+};
+// the lines of a component are stored in walking order in component_edges[first, first + count).
+// an opened component always starts at a three sided box.
+struct Component {
+    int kind;
+    int length;
+    int first;
+    int count;
+};
+
+// solve_components() results by component_key(), direct mapped so a solve never allocates
+struct ChainMemoSlot {
+    uint64_t key;
+    int value;
+    bool used;
+};
+const size_t CHAIN_MEMO_SLOTS = 1 << 14;
+
+// one search: the position it works on plus all of its scratch. big (the move buffers alone are
+// over a megabyte), so it lives on the heap
+struct SearchContext {
+    Board board = {};                    // all zero until the first turn input is read
+    EngineConfig config;
+    TransTable* tt = &main_table;
+    std::unique_ptr<MctsTree> tree;      // --engine mcts, allocated by the first search
+    SearchShared own_shared;
+    SearchShared* shared = &own_shared;  // a helper's points at the search it helps
+    SearchStats stats = {};
+    const char* move_branch = "";        // which part of winning_move() picked the move
+    bool move_scored = false;            // whether the search or the solver gave the move a score
+    int move_score = 0;                  // that score, in eval_board() units from the ai's view
+    int ponder_depth = 0;                // how deep pondering got before this move
+    bool table_aged = false;             // pondering already moved tt to the next search's age
+    long long game_time_used = 0;
+
+    // move ordering: two killer moves per ply and a history score per edge
+    int killers[MAX_PLY][2];
+    int history[MAX_EDGE_ID] = {};
+
+    // every ply generates into its own preallocated slice, so the search never touches the heap
+    int move_stack[MAX_PLY][MAX_MOVES];
+    int order_keys[MAX_PLY][MAX_MOVES];
+
+    // endgame solver scratch
+    Component components[MAX_BOX_ID];
+    int component_edges[MAX_MOVES];
+    int component_count = 0;
+    int component_edge_count = 0;
+    int box_seen[MAX_BOX_ID] = {};
+    int seen_stamp = 0;
+    std::vector<ChainMemoSlot> chain_memo;  // CHAIN_MEMO_SLOTS, allocated by the first solve
+    std::vector<int> closed_codes;
+    std::vector<int> other_codes;           // the closed components but the one solve_endgame() opens
+    std::vector<int> rest_codes[MAX_BOX_ID];  // solve_components() scratch, one per list length
+
+    SearchContext()
+    {
+        clear_killers();
+    }
+
+    // -1 matches no edge
+    void clear_killers()
+    {
+        for (int i = 0; i < MAX_PLY; ++i)
+        {
+            killers[i][0] = killers[i][1] = -1;
+        }
+    }
+};
+
+void default_arr();
+void init_zobrist();
+void init_symmetries();
+void tt_resize(TransTable& table, size_t mb);
+int move_gen(const Board& b, int* out);
+int eval_board(const Board& b, EvalProfile profile);
+int apply_move(Board& b, int edge);
+void undo_move(Board& b, int edge);
+bool game_state(const Board& b);
+
+int iterative_deepening(SearchContext& ctx, std::vector<int>& moves);
+int mcts_search(SearchContext& ctx, std::vector<int>& moves);
+Move winning_move(SearchContext& ctx);
+string translate(const Move& move);
+bool parse_turn_input(Board& b);
+
+inline int h_edge(int r, int c)
+{
+    return r * ROW_BITS + c;
+}
+
+inline int v_edge(int r, int c)
+{
+    return (V_BASE + r) * ROW_BITS + c;
+}
+
+inline bool has_line(const Board& b, int edge)
+{
+    return (b.lines.row[edge / ROW_BITS] >> (edge % ROW_BITS)) & 1;
+}
+
+Move edge_move(int edge)
+{
+    int slot = edge / ROW_BITS;
+    if (slot < V_BASE)
+    {
+        return {slot, edge % ROW_BITS, HORIZONTAL};
+    }
+    return {slot - V_BASE, edge % ROW_BITS, VERTICAL};
+}
+
+int move_edge(const Move& move)
+{
+    return (move.type == HORIZONTAL) ? h_edge(move.r, move.c) : v_edge(move.r, move.c);
+}
+
+// every box of the board sorted by side count at once: count[k][r] has bit c set when box (r, c)
+// has k sides. the four sides of a row of boxes are the two horizontal rows around it and the
+// vertical row shifted by 0 and 1, added bit-sliced into a 3 bit count per box.
+struct SideMasks {
+    uint32_t count[5][MAX_DIM];
+};
+
+inline void side_masks_row(uint32_t top, uint32_t bottom, uint32_t left, uint32_t right, uint32_t mask, SideMasks& out, int r)
+{
+    uint32_t s1 = top ^ bottom, c1 = top & bottom;
+    uint32_t s2 = left ^ right, c2 = left & right;
+    uint32_t bit0 = s1 ^ s2;
+    uint32_t bit1 = c1 ^ c2 ^ (s1 & s2);
+    uint32_t bit2 = c1 & c2;
+    out.count[0][r] = ~(bit0 | bit1 | bit2) & mask;
+    out.count[1][r] = bit0 & ~bit1 & ~bit2 & mask;
+    out.count[2][r] = ~bit0 & bit1 & mask;
+    out.count[3][r] = bit0 & bit1 & mask;
+    out.count[4][r] = bit2 & mask;
+}
+
+void side_masks_scalar(const EdgeSet& lines, int box_rows, uint32_t mask, SideMasks& out, int first_row)
+{
+    for (int r = first_row; r < box_rows; ++r)
+    {
+        uint32_t v = lines.row[V_BASE + r];
+        side_masks_row(lines.row[r], lines.row[r + 1], v & mask, (v >> 1) & mask, mask, out, r);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// the same adder on eight box rows per instruction. the rows of each kind of line are contiguous,
+// so a block is three unaligned loads; a tail of fewer than eight rows goes to the scalar version.
+__attribute__((target("avx2")))
+void side_masks_avx2(const EdgeSet& lines, int box_rows, uint32_t mask, SideMasks& out, int first_row)
+{
+    const __m256i m = _mm256_set1_epi32((int)mask);
+    int r = first_row;
+    for (; r + 8 <= box_rows; r += 8)
+    {
+        __m256i top = _mm256_loadu_si256((const __m256i*)(lines.row + r));
+        __m256i bottom = _mm256_loadu_si256((const __m256i*)(lines.row + r + 1));
+        __m256i v = _mm256_loadu_si256((const __m256i*)(lines.row + V_BASE + r));
+        __m256i left = _mm256_and_si256(v, m);
+        __m256i right = _mm256_and_si256(_mm256_srli_epi32(v, 1), m);
+        __m256i s1 = _mm256_xor_si256(top, bottom), c1 = _mm256_and_si256(top, bottom);
+        __m256i s2 = _mm256_xor_si256(left, right), c2 = _mm256_and_si256(left, right);
+        __m256i bit0 = _mm256_xor_si256(s1, s2);
+        __m256i bit1 = _mm256_xor_si256(_mm256_xor_si256(c1, c2), _mm256_and_si256(s1, s2));
+        __m256i bit2 = _mm256_and_si256(c1, c2);
+        __m256i any = _mm256_or_si256(_mm256_or_si256(bit0, bit1), bit2);
+        __m256i odd = _mm256_andnot_si256(bit2, bit0);
+        _mm256_storeu_si256((__m256i*)(out.count[0] + r), _mm256_andnot_si256(any, m));
+        _mm256_storeu_si256((__m256i*)(out.count[1] + r), _mm256_and_si256(_mm256_andnot_si256(bit1, odd), m));
+        _mm256_storeu_si256((__m256i*)(out.count[2] + r), _mm256_and_si256(_mm256_andnot_si256(bit0, bit1), m));
+        _mm256_storeu_si256((__m256i*)(out.count[3] + r), _mm256_and_si256(_mm256_and_si256(bit0, bit1), m));
+        _mm256_storeu_si256((__m256i*)(out.count[4] + r), _mm256_and_si256(bit2, m));
+    }
+    side_masks_scalar(lines, box_rows, mask, out, r);
+}
+#endif
+
+typedef void (*SideMasksKernel)(const EdgeSet&, int, uint32_t, SideMasks&, int);
+
+SideMasksKernel pick_side_masks_kernel()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return side_masks_avx2;
+    }
+#endif
+    return side_masks_scalar;
+}
+
+// chosen once at startup from what the cpu supports
+const SideMasksKernel side_masks_kernel = pick_side_masks_kernel();
+
+void side_masks(const Board& b, SideMasks& out)
+{
+    side_masks_kernel(b.lines, rows - 1, box_mask, out, 0);
+}
+
+uint64_t splitmix64(uint64_t& state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void init_zobrist()
+{
+    // fixed seed so hashes are the same from run to run
+    uint64_t state = 0x5A0B1A57D07B0C5ULL;
+    for (int e = 0; e < MAX_EDGE_ID; ++e)
+    {
+        zobrist_edge[e] = splitmix64(state);
+    }
+    zobrist_side = splitmix64(state);
+}
+
+// full recount of side_count and sided_boxes from the line bits, used after input is parsed
+void recount_sides(Board& b)
+{
+    SideMasks masks;
+    side_masks(b, masks);
+    for (int k = 0; k < 5; ++k)
+    {
+        b.sided_boxes[k] = 0;
+        for (int r = 0; r < rows - 1; ++r)
+        {
+            b.sided_boxes[k] += __builtin_popcount(masks.count[k][r]);
+            for (uint32_t bits = masks.count[k][r]; bits; bits &= bits - 1)
+            {
+                b.side_count[r * ROW_BITS + __builtin_ctz(bits)] = k;
+            }
+        }
+    }
+    for (int r = 0; r < MAX_DIM; ++r)
+    {
+        b.two_sided.row[r] = r < rows - 1 ? masks.count[2][r] : 0;
+        b.three_sided.row[r] = r < rows - 1 ? masks.count[3][r] : 0;
+    }
+}
+
+// the boxes of a set next to every line of an edge row: a horizontal row borders the box rows
+// above and below it, bit c of a vertical row the boxes c - 1 and c of its own row
+inline uint32_t boxes_near_row(const BoxSet& boxes, int slot)
+{
+    if (slot < V_BASE)
+    {
+        return (slot > 0 ? boxes.row[slot - 1] : 0) | (slot < rows - 1 ? boxes.row[slot] : 0);
+    }
+    uint32_t row = boxes.row[slot - V_BASE];
+    return row | row << 1;
+}
+
+// full recompute, used after the board is rebuilt from input
+void rehash(Board& b)
+{
+    b.board_hash = 0;
+    for (int k = 0; k < sym_count; ++k)
+    {
+        b.sym_hash[k] = 0;
+    }
+    for (int slot = 0; slot < EDGE_SLOTS; ++slot)
+    {
+        uint32_t bits = b.lines.row[slot];
+        while (bits)
+        {
+            int edge = slot * ROW_BITS + __builtin_ctz(bits);
+            b.board_hash ^= zobrist_edge[edge];
+            for (int k = 0; k < sym_count; ++k)
+            {
+                b.sym_hash[k] ^= zobrist_edge[sym_edge[k][edge]];
+            }
+            bits &= bits - 1;
+        }
+    }
+}
+
+// hash of the position in its canonical orientation, sym is set to the transform that gets there
+inline uint64_t canonical_hash(const Board& b, int& sym)
+{
+    uint64_t best = b.sym_hash[0];
+    sym = 0;
+    for (int k = 1; k < sym_count; ++k)
+    {
+        if (b.sym_hash[k] < best)
+        {
+            best = b.sym_hash[k];
+            sym = k;
+        }
+    }
+    return best;
+}
+
+// true when the transform maps the drawn lines onto themselves, checked line by line so a hash
+// collision can't merge two different root moves
+bool symmetric_under(const Board& b, int sym)
+{
+    for (int slot = 0; slot < EDGE_SLOTS; ++slot)
+    {
+        uint32_t bits = b.lines.row[slot];
+        while (bits)
+        {
+            if (!has_line(b, sym_edge[sym][slot * ROW_BITS + __builtin_ctz(bits)]))
+            {
+                return false;
+            }
+            bits &= bits - 1;
+        }
+    }
+    return true;
+}
+
+void tt_resize(TransTable& table, size_t mb)
+{
+    size_t entries = 1;
+    while (entries * 2 * sizeof(TTSlot) <= mb * 1024 * 1024)
+    {
+        entries *= 2;
+    }
+    if (table.mask + 1 != entries || !table.slots)
+    {
+        table.slots.reset(new TTSlot[entries]);
+    }
+    for (size_t i = 0; i < entries; ++i)
+    {
+        table.slots[i].check.store(0, std::memory_order_relaxed);
+        table.slots[i].data.store(0, std::memory_order_relaxed);
+    }
+    table.mask = entries - 1;
+}
+
+// data layout: score in bits 0-31, depth 32-39, move + 1 40-51, bound 52-53, age 54-61, 63 marks
+// a used slot
+const uint64_t TT_USED = 1ULL << 63;
+
+uint64_t tt_pack(const TTEntry& entry)
+{
+    return (uint64_t)(uint32_t)entry.score
+         | ((uint64_t)entry.depth << 32)
+         | ((uint64_t)(entry.move + 1) << 40)
+         | ((uint64_t)entry.bound << 52)
+         | ((uint64_t)entry.age << 54)
+         | TT_USED;
+}
+
+TTEntry tt_unpack(uint64_t data)
+{
+    TTEntry entry;
+    entry.score = (int32_t)(uint32_t)data;
+    entry.depth = (data >> 32) & 0xFF;
+    entry.move = (int)((data >> 40) & 0xFFF) - 1;
+    entry.bound = (data >> 52) & 3;
+    entry.age = (data >> 54) & 0xFF;
+    return entry;
+}
+
+bool tt_probe(const TransTable& table, uint64_t key, TTEntry& entry)
+{
+    TTSlot& slot = table.slots[key & table.mask];
+    uint64_t data = slot.data.load(std::memory_order_relaxed);
+    uint64_t check = slot.check.load(std::memory_order_relaxed);
+    if (!(data & TT_USED) || (check ^ data) != key)
+    {
+        return false;
+    }
+    entry = tt_unpack(data);
+    return true;
+}
+
+void tt_store(TransTable& table, uint64_t key, int depth, int score, int bound, int move)
+{
+    // depth preferred, but entries left over from earlier turns are always replaced
+    TTSlot& slot = table.slots[key & table.mask];
+    uint64_t old_data = slot.data.load(std::memory_order_relaxed);
+    uint64_t old_check = slot.check.load(std::memory_order_relaxed);
+    if ((old_data & TT_USED) && (old_check ^ old_data) != key)
+    {
+        TTEntry old = tt_unpack(old_data);
+        if (old.age == table.age && old.depth > depth)
+        {
+            return;
+        }
+    }
+    uint64_t data = tt_pack({score, depth, move, bound, table.age});
+    slot.data.store(data, std::memory_order_relaxed);
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+}
+
+// the line between two dots after it has been moved by a symmetry, dots are (x, y) = (column, row)
+int dots_edge(int x1, int y1, int x2, int y2)
+{
+    if (y1 == y2)
+    {
+        return h_edge(y1, std::min(x1, x2));
+    }
+    return v_edge(std::min(y1, y2), x1);
+}
+
+// the dihedral transforms of the dot grid: identity, the three flips/half turn, then the four that
+// swap rows and columns, which only fit a square board
+void init_symmetries()
+{
+    int w = columns - 1;
+    int h = rows - 1;
+    sym_count = (w == h) ? 8 : 4;
+    for (int k = 0; k < sym_count; ++k)
+    {
+        for (int e = 0; e < MAX_EDGE_ID; ++e)
+        {
+            sym_edge[k][e] = e;
+        }
+        auto map_dot = [k, w, h](int& x, int& y) {
+            int tx = (k & 1) ? w - x : x;
+            int ty = (k & 2) ? h - y : y;
+            if (k & 4)
+            {
+                std::swap(tx, ty);
+            }
+            x = tx;
+            y = ty;
+        };
+        for (int r = 0; r < rows; ++r)
+        {
+            for (int c = 0; c < columns; ++c)
+            {
+                int x1 = c, y1 = r, x2 = c + 1, y2 = r;  // horizontal line right of dot (r, c)
+                int x3 = c, y3 = r, x4 = c, y4 = r + 1;  // vertical line below it
+                map_dot(x1, y1);
+                map_dot(x2, y2);
+                map_dot(x3, y3);
+                map_dot(x4, y4);
+                if (c < columns - 1) sym_edge[k][h_edge(r, c)] = dots_edge(x1, y1, x2, y2);
+                if (r < rows - 1) sym_edge[k][v_edge(r, c)] = dots_edge(x3, y3, x4, y4);
+            }
+        }
+    }
+    for (int k = 0; k < sym_count; ++k)
+    {
+        for (int j = 0; j < sym_count; ++j)
+        {
+            bool undoes = true;
+            for (int e = 0; e < MAX_EDGE_ID && undoes; ++e)
+            {
+                undoes = sym_edge[j][sym_edge[k][e]] == e;
+            }
+            if (undoes)
+            {
+                sym_inverse[k] = j;
+            }
+        }
+    }
+}
+
+// empty board, the geometry comes from default_arr()
+void clear_board(Board& b)
+{
+    for (int i = 0; i < EDGE_SLOTS; ++i)
+    {
+        b.lines.row[i] = 0;
+    }
+    for (int p = 0; p < 2; ++p)
+    {
+        for (int i = 0; i < MAX_DIM; ++i)
+        {
+            b.owned[p].row[i] = 0;
+        }
+    }
+    b.bot_score = 0;
+    b.opp_score = 0;
+}
+
+void default_arr()
+{
+    h_mask = (1u << (columns - 1)) - 1;
+    v_mask = (1u << columns) - 1;
+    box_mask = h_mask;
+    for (int e = 0; e < MAX_EDGE_ID; ++e)
+    {
+        edge_boxes[e][0] = edge_boxes[e][1] = -1;
+    }
+    for (int r = 0; r < rows; ++r)
+    {
+        for (int c = 0; c < columns - 1; ++c)
+        {
+            int e = h_edge(r, c);
+            if (r < rows - 1) edge_boxes[e][0] = r * ROW_BITS + c;
+            if (r > 0) edge_boxes[e][1] = (r - 1) * ROW_BITS + c;
+        }
+    }
+    for (int r = 0; r < rows - 1; ++r)
+    {
+        for (int c = 0; c < columns; ++c)
+        {
+            int e = v_edge(r, c);
+            if (c < columns - 1) edge_boxes[e][0] = r * ROW_BITS + c;
+            if (c > 0) edge_boxes[e][1] = r * ROW_BITS + c - 1;
+        }
+    }
+    for (int r = 0; r < rows - 1; ++r)
+    {
+        for (int c = 0; c < columns - 1; ++c)
+        {
+            int box = r * ROW_BITS + c;
+            box_edges[box][0] = h_edge(r, c);
+            box_edges[box][1] = h_edge(r + 1, c);
+            box_edges[box][2] = v_edge(r, c);
+            box_edges[box][3] = v_edge(r, c + 1);
+        }
+    }
+    init_symmetries();
+}
+
+template <int N>
+int move_gen(const Board& b, int* out)
+{
+    // free lines come out in the old order: horizontal rows first, then vertical rows
+    typedef Grid<N> G;
+    int count = 0;
+    for (int i = 0; i < G::rows(); ++i)
+    {
+        uint32_t free_bits = ~b.lines.row[i] & G::h_mask();
+        while (free_bits)
+        {
+            out[count++] = i * ROW_BITS + __builtin_ctz(free_bits);
+            free_bits &= free_bits - 1;
+        }
+    }
+    for (int i = 0; i < G::rows() - 1; ++i)
+    {
+        uint32_t free_bits = ~b.lines.row[V_BASE + i] & G::v_mask();
+        while (free_bits)
+        {
+            out[count++] = (V_BASE + i) * ROW_BITS + __builtin_ctz(free_bits);
+            free_bits &= free_bits - 1;
+        }
+    }
+    return count;
+}
+
+int move_gen(const Board& b, int* out)
+{
+    return move_gen<0>(b, out);
+}
+
+int eval_board(const Board& b, EvalProfile profile)
+{
+    int p1 = A * (b.bot_score - b.opp_score);
+    if (profile == EVAL_FINAL)
+    {
+        // final.cpp's eval, so self play can measure the two against each other
+        return p1 - B * b.sided_boxes[3];
+    }
+    int p2 = 5 * b.sided_boxes[3];
+    int p3 = 1 * b.sided_boxes[2];
+    int p4 = 0.5 * b.sided_boxes[1];
+    // if ((bot_score - opp_score) > 30) {
+    //   return p1 - p2;
+    // }
+
+    // improved heuristics, now assigns scores based on the number of sides that a box has completed
+    return p1 - p2 + p3 + p4;
+}
+
+// keeps a box's bits in two_sided and three_sided in step with its side count, without
+// branching on a count the search can't predict
+inline void update_sided(Board& b, int box)
+{
+    int r = box / ROW_BITS;
+    uint32_t bit = 1u << (box % ROW_BITS);
+    int sides = b.side_count[box];
+    b.two_sided.row[r] = (b.two_sided.row[r] & ~bit) | (sides == 2 ? bit : 0);
+    b.three_sided.row[r] = (b.three_sided.row[r] & ~bit) | (sides == 3 ? bit : 0);
+}
+
+int apply_move(Board& b, int edge)
+{
+    // a box is captured when the new line is its fourth side
+    b.lines.row[edge / ROW_BITS] |= 1u << (edge % ROW_BITS);
+    b.board_hash ^= zobrist_edge[edge];
+    for (int k = 0; k < sym_count; ++k)
+    {
+        b.sym_hash[k] ^= zobrist_edge[sym_edge[k][edge]];
+    }
+    int boxed = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        int box = edge_boxes[edge][i];
+        if (box < 0)
+        {
+            continue;
+        }
+        b.sided_boxes[b.side_count[box]]--;
+        b.sided_boxes[++b.side_count[box]]++;
+        update_sided(b, box);
+        if (b.side_count[box] == 4)
+        {
+            b.owned[b.turn].row[box / ROW_BITS] |= 1u << (box % ROW_BITS);
+            boxed++;
+        }
+    }
+    if (boxed > 0)
+    {
+        if (b.turn == AI)
+        {
+            b.bot_score += boxed;
+        }
+        else
+        {
+            b.opp_score += boxed;
+        }
+    }
+    return boxed;
+}
+
+void undo_move(Board& b, int edge)
+{
+    // lines are undone in reverse order, so every owned box next to this line was closed by it
+    for (int i = 0; i < 2; ++i)
+    {
+        int box = edge_boxes[edge][i];
+        if (box < 0)
+        {
+            continue;
+        }
+        uint32_t bit = 1u << (box % ROW_BITS);
+        if (b.owned[AI].row[box / ROW_BITS] & bit)
+        {
+            b.owned[AI].row[box / ROW_BITS] &= ~bit;
+            b.bot_score--;
+        }
+        else if (b.owned[HUMAN].row[box / ROW_BITS] & bit)
+        {
+            b.owned[HUMAN].row[box / ROW_BITS] &= ~bit;
+            b.opp_score--;
+        }
+        b.sided_boxes[b.side_count[box]]--;
+        b.sided_boxes[--b.side_count[box]]++;
+        update_sided(b, box);
+    }
+    b.lines.row[edge / ROW_BITS] &= ~(1u << (edge % ROW_BITS));
+    b.board_hash ^= zobrist_edge[edge];
+    for (int k = 0; k < sym_count; ++k)
+    {
+        b.sym_hash[k] ^= zobrist_edge[sym_edge[k][edge]];
+    }
+}
+
+template <int N>
+bool game_state(const Board& b)
+{
+    // checks if game has been completed
+    typedef Grid<N> G;
+    return (b.bot_score + b.opp_score == (G::rows() - 1) * (G::columns() - 1));
+}
+
+bool game_state(const Board& b)
+{
+    return game_state<0>(b);
+}
+
+// a free line next to a three sided box captures it
+inline bool is_capture(const Board& b, int edge)
+{
+    int slot = edge / ROW_BITS;
+    return (boxes_near_row(b.three_sided, slot) >> (edge % ROW_BITS)) & 1;
+}
+
+// a free line that neither captures nor hands a box to the opponent
+inline bool is_safe(const Board& b, int edge)
+{
+    int slot = edge / ROW_BITS;
+    uint32_t near = boxes_near_row(b.two_sided, slot) | boxes_near_row(b.three_sided, slot);
+    return !((near >> (edge % ROW_BITS)) & 1);
+}
+
+// the capturing lines and the unsafe ones (capturing or handing a box over) of every row of lines
+// on the board, drawn or not. one pass over the rows is cheaper than testing the moves one by one.
+template <int N>
+void line_classes(const Board& b, EdgeSet& capture, EdgeSet& unsafe)
+{
+    typedef Grid<N> G;
+    uint32_t above3 = 0;
+    uint32_t above2 = 0;
+    for (int r = 0; r < G::rows(); ++r)
+    {
+        uint32_t below3 = r < G::rows() - 1 ? b.three_sided.row[r] : 0;
+        uint32_t below2 = r < G::rows() - 1 ? b.two_sided.row[r] : 0;
+        capture.row[r] = above3 | below3;
+        unsafe.row[r] = above3 | below3 | above2 | below2;
+        above3 = below3;
+        above2 = below2;
+    }
+    for (int r = 0; r < G::rows() - 1; ++r)
+    {
+        uint32_t three = b.three_sided.row[r];
+        uint32_t two = b.two_sided.row[r];
+        capture.row[V_BASE + r] = three | three << 1;
+        unsafe.row[V_BASE + r] = three | three << 1 | two | two << 1;
+    }
+}
+
+void line_classes(const Board& b, EdgeSet& capture, EdgeSet& unsafe)
+{
+    line_classes<0>(b, capture, unsafe);
+}
+
+// a chain of three or more two sided boxes, or a loop, that no capture leads into is opened the
+// same wherever the line goes: the opponent takes all of it, or all but two and hands those back.
+// so of the lines between its boxes and onto the border only the lowest is searched. the lines
+// that lead out of it into another box change that box and are kept. returns the new count.
+template <int N>
+int drop_equivalent_moves(const Board& b, int* moves, int count)
+{
+    typedef Grid<N> G;
+    BoxSet todo = b.two_sided;
+    EdgeSet dropped = {};
+    bool any = false;
+    int stack[MAX_DIM * MAX_DIM];
+    int inside[MAX_MOVES];
+    for (int r = 0; r < G::rows() - 1; ++r)
+    {
+        while (todo.row[r])
+        {
+            int start = r * ROW_BITS + __builtin_ctz(todo.row[r]);
+            todo.row[r] &= todo.row[r] - 1;
+            int top = 0;
+            int boxes = 0;
+            int lines = 0;
+            bool open = false;
+            stack[top++] = start;
+            while (top > 0)
+            {
+                int box = stack[--top];
+                boxes++;
+                for (int k = 0; k < 4; ++k)
+                {
+                    int e = box_edges[box][k];
+                    if (has_line(b, e))
+                    {
+                        continue;
+                    }
+                    int other = edge_boxes[e][edge_boxes[e][0] == box];
+                    if (other < 0)
+                    {
+                        inside[lines++] = e;
+                    }
+                    else if (b.side_count[other] == 2)
+                    {
+                        // every inside line is seen from both of its boxes, keep it once
+                        if (box < other)
+                        {
+                            inside[lines++] = e;
+                        }
+                        uint32_t bit = 1u << (other % ROW_BITS);
+                        if (todo.row[other / ROW_BITS] & bit)
+                        {
+                            todo.row[other / ROW_BITS] &= ~bit;
+                            stack[top++] = other;
+                        }
+                    }
+                    else if (b.side_count[other] == 3)
+                    {
+                        open = true;
+                    }
+                }
+            }
+            if (open || boxes < 3)
+            {
+                continue;
+            }
+            int lowest = *std::min_element(inside, inside + lines);
+            for (int i = 0; i < lines; ++i)
+            {
+                if (inside[i] != lowest)
+                {
+                    dropped.row[inside[i] / ROW_BITS] |= 1u << (inside[i] % ROW_BITS);
+                    any = true;
+                }
+            }
+        }
+    }
+    if (!any)
+    {
+        return count;
+    }
+    int kept = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        if (!((dropped.row[moves[i] / ROW_BITS] >> (moves[i] % ROW_BITS)) & 1))
+        {
+            moves[kept++] = moves[i];
+        }
+    }
+    return kept;
+}
+
+int drop_equivalent_moves(const Board& b, int* moves, int count)
+{
+    return drop_equivalent_moves<0>(b, moves, count);
+}
+
+// captures first, then the table move, killers, and the remaining moves by history with safe
+// lines ahead of sacrifices
+template <int N>
+void score_moves(SearchContext& ctx, const int* moves, int* keys, int count, int tt_move, int ply)
+{
+    EdgeSet capture;
+    EdgeSet unsafe;
+    line_classes<N>(ctx.board, capture, unsafe);
+    for (int i = 0; i < count; ++i)
+    {
+        int move = moves[i];
+        int key = ctx.history[move];
+        uint32_t bit = 1u << (move % ROW_BITS);
+        if (capture.row[move / ROW_BITS] & bit)
+        {
+            key += 5 * HISTORY_MAX;
+        }
+        else if (move == tt_move)
+        {
+            key += 4 * HISTORY_MAX;
+        }
+        else if (move == ctx.killers[ply][0])
+        {
+            key += 3 * HISTORY_MAX;
+        }
+        else if (move == ctx.killers[ply][1])
+        {
+            key += 2 * HISTORY_MAX;
+        }
+        else if (!(unsafe.row[move / ROW_BITS] & bit))
+        {
+            key += HISTORY_MAX;
+        }
+        keys[i] = key;
+    }
+}
+
+// moves the best remaining move into slot i and returns it. picking lazily is cheaper than a
+// full sort because most nodes cut off after a few moves; ties keep the generation order.
+int pick_move(int* moves, int* keys, int count, int i)
+{
+    int best = i;
+    for (int j = i + 1; j < count; ++j)
+    {
+        if (keys[j] > keys[best])
+        {
+            best = j;
+        }
+    }
+    std::swap(moves[i], moves[best]);
+    std::swap(keys[i], keys[best]);
+    return moves[i];
+}
+
+// a quiet move that caused a cutoff becomes a killer for this ply and gains history
+void record_cutoff(SearchContext& ctx, int move, int depth, int ply, int index)
+{
+    Board& b = ctx.board;
+    ctx.stats.cutoffs++;
+    if (index == 0)
+    {
+        ctx.stats.first_cutoffs++;
+    }
+    if (is_capture(b, move))
+    {
+        return;
+    }
+    if (ctx.killers[ply][0] != move)
+    {
+        ctx.killers[ply][1] = ctx.killers[ply][0];
+        ctx.killers[ply][0] = move;
+    }
+    ctx.history[move] += depth * depth;
+    if (ctx.history[move] >= HISTORY_MAX)
+    {
+        for (int e = 0; e < MAX_EDGE_ID; ++e)
+        {
+            ctx.history[e] /= 2;
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// endgame solver. once every undecided box has at least two sides drawn the board falls apart into
+// chains and loops, possibly some of them already opened, and the rest of the game can be solved
+// exactly on whole components instead of single lines.
+
+inline int other_box(int edge, int box)
+{
+    return edge_boxes[edge][0] == box ? edge_boxes[edge][1] : edge_boxes[edge][0];
+}
+
+// walks a path starting at box, which was entered through line `from` (-1 for a three sided
+// start), recording every line crossed. returns true when the far end is a three sided box.
+bool walk_path(SearchContext& ctx, int box, int from, Component& comp)
+{
+    Board& b = ctx.board;
+    while (true)
+    {
+        ctx.box_seen[box] = ctx.seen_stamp;
+        comp.length++;
+        int next = -1;
+        for (int k = 0; k < 4; ++k)
+        {
+            int e = box_edges[box][k];
+            if (!has_line(b, e) && e != from)
+            {
+                next = e;
+                break;
+            }
+        }
+        if (next < 0)
+        {
+            return true;
+        }
+        ctx.component_edges[ctx.component_edge_count++] = next;
+        int neighbour = other_box(next, box);
+        if (neighbour < 0)
+        {
+            return false;
+        }
+        box = neighbour;
+        from = next;
+    }
+}
+
+Component& new_component(SearchContext& ctx, int kind)
+{
+    Component& comp = ctx.components[ctx.component_count++];
+    comp.kind = kind;
+    comp.length = 0;
+    comp.first = ctx.component_edge_count;
+    comp.count = 0;
+    return comp;
+}
+
+// splits the board into components. only valid when no undecided box has fewer than two sides.
+void decompose_chains(SearchContext& ctx)
+{
+    Board& b = ctx.board;
+    ctx.component_count = 0;
+    ctx.component_edge_count = 0;
+    ++ctx.seen_stamp;
+
+    // opened components first, so they are always walked from a three sided end
+    for (int r = 0; r < rows - 1; ++r)
+    {
+        for (int c = 0; c < columns - 1; ++c)
+        {
+            int box = r * ROW_BITS + c;
+            if (b.side_count[box] == 3 && ctx.box_seen[box] != ctx.seen_stamp)
+            {
+                Component& comp = new_component(ctx, OPENED);
+                if (walk_path(ctx, box, -1, comp))
+                {
+                    comp.kind = OPENED_BOTH;
+                }
+                comp.count = ctx.component_edge_count - comp.first;
+            }
+        }
+    }
+    // then chains, from the end that touches the border
+    for (int r = 0; r < rows - 1; ++r)
+    {
+        for (int c = 0; c < columns - 1; ++c)
+        {
+            int box = r * ROW_BITS + c;
+            if (b.side_count[box] != 2 || ctx.box_seen[box] == ctx.seen_stamp)
+            {
+                continue;
+            }
+            for (int k = 0; k < 4; ++k)
+            {
+                int e = box_edges[box][k];
+                if (!has_line(b, e) && other_box(e, box) < 0)
+                {
+                    Component& comp = new_component(ctx, CHAIN);
+                    ctx.component_edges[ctx.component_edge_count++] = e;
+                    walk_path(ctx, box, e, comp);
+                    comp.count = ctx.component_edge_count - comp.first;
+                    break;
+                }
+            }
+        }
+    }
+    // whatever is left are loops
+    for (int r = 0; r < rows - 1; ++r)
+    {
+        for (int c = 0; c < columns - 1; ++c)
+        {
+            int start = r * ROW_BITS + c;
+            if (b.side_count[start] != 2 || ctx.box_seen[start] == ctx.seen_stamp)
+            {
+                continue;
+            }
+            Component& comp = new_component(ctx, LOOP);
+            int box = start;
+            int from = -1;
+            do
+            {
+                ctx.box_seen[box] = ctx.seen_stamp;
+                comp.length++;
+                for (int k = 0; k < 4; ++k)
+                {
+                    int e = box_edges[box][k];
+                    if (!has_line(b, e) && e != from)
+                    {
+                        from = e;
+                        break;
+                    }
+                }
+                ctx.component_edges[ctx.component_edge_count++] = from;
+                box = other_box(from, box);
+            } while (box != start);
+            comp.count = ctx.component_edge_count - comp.first;
+        }
+    }
+}
+
+// a whole file mapped read only, nullptr when it can't be opened. the book and the tablebase are
+// used straight from the mapping.
+const char* map_file(const std::string& path, size_t& size)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+    struct stat st;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        size = st.st_size;
+        data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+    return data == MAP_FAILED ? nullptr : (const char*)data;
+}
+
+// component tablebase: the exact value of every set of closed chains and loops up to a number of
+// boxes, as solve_components() computes it, generated offline by tablebase_build(). entries are
+// sorted by the same key the memo uses. component sets don't depend on the board, so one file
+// serves every board size.
+struct TablebaseHeader {
+    char magic[8];
+    uint32_t max_boxes;
+    uint32_t count;
+};
+struct TablebaseEntry {
+    uint64_t key;
+    int32_t value;
+    int32_t boxes;
+};
+const char TABLEBASE_MAGIC[8] = {'D', 'B', 'C', 'O', 'M', 'P', '1', 0};
+
+const TablebaseEntry* tablebase_entries = nullptr;
+size_t tablebase_count = 0;
+int tablebase_max_boxes = 0;
+
+bool tablebase_load(const std::string& path)
+{
+    size_t size;
+    const char* data = map_file(path, size);
+    if (!data)
+    {
+        return false;
+    }
+    const TablebaseHeader* header = (const TablebaseHeader*)data;
+    if (size < sizeof(TablebaseHeader)
+        || std::memcmp(header->magic, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC)) != 0
+        || sizeof(TablebaseHeader) + header->count * sizeof(TablebaseEntry) > size)
+    {
+        munmap((void*)data, size);
+        return false;
+    }
+    tablebase_entries = (const TablebaseEntry*)(header + 1);
+    tablebase_count = header->count;
+    tablebase_max_boxes = header->max_boxes;
+    return true;
+}
+
+bool tablebase_probe(uint64_t key, int& value)
+{
+    const TablebaseEntry* end = tablebase_entries + tablebase_count;
+    const TablebaseEntry* it = std::lower_bound(tablebase_entries, end, key, [](const TablebaseEntry& entry, uint64_t k) {
+        return entry.key < k;
+    });
+    if (it == end || it->key != key)
+    {
+        return false;
+    }
+    value = it->value;
+    return true;
+}
+
+// key of a sorted list of component codes, shared by the memo and the tablebase
+uint64_t component_key(const std::vector<int>& codes)
+{
+    uint64_t key = 0x84222325CBF29CE4ULL;
+    for (int code : codes)
+    {
+        key = (key ^ (uint64_t)code) * 0x100000001B3ULL;
+    }
+    return key;
+}
+
+// value of opening a closed component for the player who opens it, given the value v of the rest
+// for whoever has to open next. the opponent either takes everything and opens the next component,
+// or takes all but the last two (four for a loop) boxes and hands the move back. two-chains are
+// opened in the middle so they can't be declined.
+inline int opening_value(int length, bool loop, int v)
+{
+    if (loop)
+    {
+        return std::min(-length - v, 8 - length + v);
+    }
+    if (length <= 2)
+    {
+        return -length - v;
+    }
+    return std::min(-length - v, 4 - length + v);
+}
+
+// best value for the player who has to open one of the closed components in codes
+// (length * 2 + loop, sorted). small sets come from the tablebase, the rest are memoized, and
+// options whose upper bound can't beat the best found so far are skipped: a long chain is worth at
+// most 2 - length to its opener, a loop 4 - length.
+int solve_components(SearchContext& ctx, const std::vector<int>& codes)
+{
+    if (codes.empty())
+    {
+        return 0;
+    }
+    uint64_t key = component_key(codes);
+    int total = 0;
+    for (int code : codes)
+    {
+        total += code / 2;
+    }
+    int value;
+    if (total <= tablebase_max_boxes && tablebase_probe(key, value))
+    {
+        return value;
+    }
+    if (ctx.chain_memo.empty())
+    {
+        ctx.chain_memo.resize(CHAIN_MEMO_SLOTS);
+    }
+    ChainMemoSlot& slot = ctx.chain_memo[key & (ctx.chain_memo.size() - 1)];
+    if (slot.used && slot.key == key)
+    {
+        return slot.value;
+    }
+
+    // every level removes one component, so each list length has a scratch list of its own
+    int best = -total - 1;
+    std::vector<int>& rest = ctx.rest_codes[codes.size() - 1];
+    for (size_t i = 0; i < codes.size(); ++i)
+    {
+        if (i > 0 && codes[i] == codes[i - 1])
+        {
+            continue;
+        }
+        int length = codes[i] / 2;
+        bool loop = codes[i] & 1;
+        int bound = loop ? 4 - length : (length <= 2 ? total - 2 * length : 2 - length);
+        if (bound <= best)
+        {
+            continue;
+        }
+        rest.assign(codes.begin(), codes.end());
+        rest.erase(rest.begin() + i);
+        best = std::max(best, opening_value(length, loop, solve_components(ctx, rest)));
+    }
+    slot = {key, best, true};
+    return best;
+}
+
+// line that opens a closed component the way opening_value() assumes
+int opening_line(SearchContext& ctx, const Component& comp)
+{
+    if (comp.kind == CHAIN && comp.length == 2)
+    {
+        return ctx.component_edges[comp.first + 1];
+    }
+    return ctx.component_edges[comp.first];
+}
+
+// exact net score, in boxes, for the player to move from here to the end of the game. only valid
+// when no undecided box has fewer than two sides. best_move, when given, receives the line to play.
+int solve_endgame(SearchContext& ctx, int* best_move)
+{
+    decompose_chains(ctx);
+
+    // reused between calls, negamax() reaches this at every endgame node
+    std::vector<int>& codes = ctx.closed_codes;
+    codes.clear();
+    int taken = 0;        // boxes sitting in opened components
+    int decline = -1;     // opened component that can be declined, preferring a chain
+    for (int i = 0; i < ctx.component_count; ++i)
+    {
+        const Component& comp = ctx.components[i];
+        if (comp.kind == CHAIN || comp.kind == LOOP)
+        {
+            codes.push_back(comp.length * 2 + (comp.kind == LOOP));
+            continue;
+        }
+        taken += comp.length;
+        if (comp.kind == OPENED && comp.length >= 2)
+        {
+            decline = i;
+        }
+        else if (comp.kind == OPENED_BOTH && comp.length >= 4 && (decline < 0 || ctx.components[decline].kind != OPENED))
+        {
+            decline = i;
+        }
+    }
+    std::sort(codes.begin(), codes.end());
+    int rest = solve_components(ctx, codes);
+
+    if (taken == 0)
+    {
+        // we have to open something: pick the component with the best opening value
+        if (best_move)
+        {
+            int best = -1000000;
+            for (int i = 0; i < ctx.component_count; ++i)
+            {
+                const Component& comp = ctx.components[i];
+                std::vector<int>& others = ctx.other_codes;
+                others.clear();
+                for (int j = 0; j < ctx.component_count; ++j)
+                {
+                    if (j != i)
+                    {
+                        others.push_back(ctx.components[j].length * 2 + (ctx.components[j].kind == LOOP));
+                    }
+                }
+                std::sort(others.begin(), others.end());
+                int value = opening_value(comp.length, comp.kind == LOOP, solve_components(ctx, others));
+                if (value > best)
+                {
+                    best = value;
+                    *best_move = opening_line(ctx, comp);
+                }
+            }
+        }
+        return rest;
+    }
+
+    // take everything and open the next component ourselves, or give the last two boxes of a chain
+    // (four of a loop) away so the opponent has to open
+    int take_all = taken + rest;
+    int declined = -1000000;
+    if (decline >= 0)
+    {
+        int handed = ctx.components[decline].kind == OPENED ? 2 : 4;
+        declined = taken - 2 * handed - rest;
+    }
+    if (best_move)
+    {
+        *best_move = ctx.component_edges[ctx.components[0].first];
+        if (declined > take_all)
+        {
+            // clear every other opened component first, then eat into the declined one until only
+            // the boxes to hand over are left
+            const Component& comp = ctx.components[decline];
+            for (int i = 0; i < ctx.component_count; ++i)
+            {
+                if (i != decline && (ctx.components[i].kind == OPENED || ctx.components[i].kind == OPENED_BOTH))
+                {
+                    *best_move = ctx.component_edges[ctx.components[i].first];
+                    return declined;
+                }
+            }
+            if (comp.kind == OPENED)
+            {
+                // the far end of the last two boxes gives both of them away in one piece
+                *best_move = comp.length > 2 ? ctx.component_edges[comp.first] : ctx.component_edges[comp.first + comp.count - 1];
+            }
+            else
+            {
+                // cutting the middle of the last four leaves two capturable pairs
+                *best_move = comp.length > 4 ? ctx.component_edges[comp.first] : ctx.component_edges[comp.first + 1];
+            }
+        }
+    }
+    return std::max(take_all, declined);
+}
+
+// true when the board is a pure chain and loop endgame the solver can finish
+inline bool solvable_endgame(const Board& b)
+{
+    return b.sided_boxes[0] == 0 && b.sided_boxes[1] == 0;
+}
+
+template <int N>
+int negamax(SearchContext& ctx, int depth, int ply, int alpha, int beta, bool ai_to_move);
+
+// a line that completes a box keeps the move, so its position is scored from the same side and
+// with the same window; any other line hands the move over
+template <int N>
+int search_child(SearchContext& ctx, int depth, int ply, int alpha, int beta, bool ai_to_move, bool captured)
+{
+    if (captured)
+    {
+        return negamax<N>(ctx, depth, ply, alpha, beta, ai_to_move);
+    }
+    return -negamax<N>(ctx, depth, ply, -beta, -alpha, !ai_to_move);
+}
+
+// below the depth limit a box with three sides makes eval_board() guess at what the captures are
+// worth, so they are played out first. the side to move either takes a box and moves again, or at
+// the last two boxes of a chain declines them with the double dealing line and hands the move
+// over; the leaf is scored once no box is left to take. nothing else is searched and nothing is
+// stored in the table.
+template <int N>
+int quiesce(SearchContext& ctx, int ply, int alpha, int beta, bool ai_to_move)
+{
+    Board& b = ctx.board;
+    if ((++ctx.stats.qnodes & 1023) == 0 && Clock::now() >= ctx.shared->deadline)
+    {
+        ctx.shared->stopped = true;
+    }
+    if (ctx.shared->stopped)
+    {
+        return 0;
+    }
+    int sign = ai_to_move ? 1 : -1;
+    if (b.sided_boxes[3] == 0 || game_state<N>(b) || ply >= MAX_PLY - 1)
+    {
+        return sign * eval_board(b, ctx.config.eval);
+    }
+    if (solvable_endgame(b))
+    {
+        return sign * A * (b.bot_score - b.opp_score) + A * solve_endgame(ctx, nullptr);
+    }
+
+    // any three sided box will do, the others are still there after it is taken
+    int box = -1;
+    for (int r = 0; r < Grid<N>::rows() - 1 && box < 0; ++r)
+    {
+        if (b.three_sided.row[r])
+        {
+            box = r * ROW_BITS + __builtin_ctz(b.three_sided.row[r]);
+        }
+    }
+    int take = -1;
+    for (int k = 0; k < 4 && take < 0; ++k)
+    {
+        int e = box_edges[box][k];
+        if (!(b.lines.row[e / ROW_BITS] & (1u << (e % ROW_BITS))))
+        {
+            take = e;
+        }
+    }
+
+    State original_turn = b.turn;
+    b.turn = ai_to_move ? AI : HUMAN;
+    apply_move(b, take);
+    ctx.stats.applied++;
+    int best = quiesce<N>(ctx, ply + 1, alpha, beta, ai_to_move);
+    undo_move(b, take);
+
+    // the box behind the capturing line ends the chain when it has two sides and its other free
+    // line leads off the board or into a box with at most one; drawing that line leaves both
+    // boxes to the opponent
+    int next = edge_boxes[take][edge_boxes[take][0] == box];
+    if (best < beta && next >= 0 && b.side_count[next] == 2 && !ctx.shared->stopped)
+    {
+        int decline = -1;
+        for (int k = 0; k < 4 && decline < 0; ++k)
+        {
+            int e = box_edges[next][k];
+            if (e != take && !(b.lines.row[e / ROW_BITS] & (1u << (e % ROW_BITS))))
+            {
+                decline = e;
+            }
+        }
+        int beyond = edge_boxes[decline][edge_boxes[decline][0] == next];
+        if (beyond < 0 || b.side_count[beyond] <= 1)
+        {
+            apply_move(b, decline);
+            ctx.stats.applied++;
+            int score = -quiesce<N>(ctx, ply + 1, -beta, -std::max(alpha, best), !ai_to_move);
+            undo_move(b, decline);
+            best = std::max(best, score);
+        }
+    }
+    b.turn = original_turn;
+    return best;
+}
+
+// principal variation search. scores are integers in eval_board() units seen from the side to
+// move, ai_to_move says which side that is. the first move is searched with the full window and
+// every later one with a null window at alpha, which only a move that beats the first fails high
+// on; only those are searched again with the full window.
+template <int N>
+int negamax(SearchContext& ctx, int depth, int ply, int alpha, int beta, bool ai_to_move)
+{
+    Board& b = ctx.board;
+    // the clock is only read every 1024 nodes
+    if ((++ctx.stats.nodes & 1023) == 0 && Clock::now() >= ctx.shared->deadline)
+    {
+        ctx.shared->stopped = true;
+    }
+    if (ctx.shared->stopped)
+    {
+        return 0;
+    }
+    int sign = ai_to_move ? 1 : -1;
+    if (game_state<N>(b))
+    {
+        return sign * eval_board(b, ctx.config.eval);
+    }
+    int base = sign * A * (b.bot_score - b.opp_score);
+    if (solvable_endgame(b))
+    {
+        // exact from here on, in the same units as the material term of eval_board()
+        return base + A * solve_endgame(ctx, nullptr);
+    }
+    if (depth == 0 || ply >= MAX_PLY - 1)
+    {
+        if (ctx.config.quiescence)
+        {
+            return quiesce<N>(ctx, ply, alpha, beta, ai_to_move);
+        }
+        return sign * eval_board(b, ctx.config.eval);
+    }
+
+    int sym;
+    uint64_t key = canonical_hash(b, sym) ^ (ai_to_move ? zobrist_side : 0);
+    int alpha_orig = alpha;
+    int beta_orig = beta;
+    int tt_move = -1;
+    TTEntry entry;
+    ctx.stats.tt_probes++;
+    if (tt_probe(*ctx.tt, key, entry))
+    {
+        ctx.stats.tt_hits++;
+        if (entry.depth >= depth)
+        {
+            int score = entry.score + base;
+            if (entry.bound == BOUND_EXACT
+                || (entry.bound == BOUND_LOWER && score >= beta)
+                || (entry.bound == BOUND_UPPER && score <= alpha))
+            {
+                return score;
+            }
+        }
+        if (entry.move >= 0)
+        {
+            // the stored move is in the canonical orientation, bring it back to this one
+            tt_move = sym_edge[sym_inverse[sym]][entry.move];
+        }
+    }
+
+    int* moves = ctx.move_stack[ply];
+    int* keys = ctx.order_keys[ply];
+    int count = drop_equivalent_moves<N>(b, moves, move_gen<N>(b, moves));
+    score_moves<N>(ctx, moves, keys, count, tt_move, ply);
+    ctx.stats.expanded++;
+
+    int best_move = -1;
+    int best_score = -SCORE_INF;
+    State original_turn = b.turn;
+    b.turn = ai_to_move ? AI : HUMAN;
+    for (int i = 0; i < count; ++i)
+    {
+        int move = pick_move(moves, keys, count, i);
+        bool captured = apply_move(b, move) > 0;
+        ctx.stats.applied++;
+        int score;
+        if (i == 0)
+        {
+            score = search_child<N>(ctx, depth - 1, ply + 1, alpha, beta, ai_to_move, captured);
+        }
+        else
+        {
+            score = search_child<N>(ctx, depth - 1, ply + 1, alpha, alpha + 1, ai_to_move, captured);
+            if (score > alpha && score < beta)
+            {
+                score = search_child<N>(ctx, depth - 1, ply + 1, alpha, beta, ai_to_move, captured);
+            }
+        }
+        undo_move(b, move);
+        if (ctx.shared->stopped)
+        {
+            break;
+        }
+        if (score > best_score)
+        {
+            best_score = score;
+            best_move = move;
+        }
+        alpha = std::max(alpha, score);
+        if (alpha >= beta)
+        {
+            record_cutoff(ctx, move, depth, ply, i);
+            break;
+        }
+    }
+    b.turn = original_turn;
+    if (ctx.shared->stopped)
+    {
+        // unfinished results never reach the table
+        return 0;
+    }
+
+    int bound = BOUND_EXACT;
+    if (best_score <= alpha_orig)
+    {
+        bound = BOUND_UPPER;
+    }
+    else if (best_score >= beta_orig)
+    {
+        bound = BOUND_LOWER;
+    }
+    tt_store(*ctx.tt, key, depth, best_score - base, bound, best_move >= 0 ? sym_edge[sym][best_move] : -1);
+    return best_score;
+}
+
+template <int N>
+int avlbl_lines(const Board& b) {
+    
+    // new function which tries and helps fix the timeouts in the endgame
+    // returns the count of number of available moves in the grid
+    typedef Grid<N> G;
+    int count = 0;
+    for (int i = 0; i < G::rows(); ++i) {
+        count += __builtin_popcount(~b.lines.row[i] & G::h_mask());
+    }
+    for (int i = 0; i < G::rows() - 1; ++i) {
+        count += __builtin_popcount(~b.lines.row[V_BASE + i] & G::v_mask());
+    }
+    return count;
+}
+
+int avlbl_lines(const Board& b) {
+    return avlbl_lines<0>(b);
+}
+
+long long move_budget_ms(SearchContext& ctx)
+{
+    Board& b = ctx.board;
+    long long budget = ctx.config.move_time_ms;
+    if (ctx.config.game_time_ms > 0)
+    {
+        // spread what is left of the game clock over the moves we still expect to make
+        long long remaining = std::max(0LL, ctx.config.game_time_ms - ctx.game_time_used);
+        budget = std::min(budget, remaining / (avlbl_lines(b) / 2 + 1));
+    }
+    return std::max(1LL, budget);
+}
+
+void add_stats(SearchStats& total, const SearchStats& add)
+{
+    total.nodes += add.nodes;
+    total.qnodes += add.qnodes;
+    total.applied += add.applied;
+    total.expanded += add.expanded;
+    total.cutoffs += add.cutoffs;
+    total.first_cutoffs += add.first_cutoffs;
+    total.tt_probes += add.tt_probes;
+    total.tt_hits += add.tt_hits;
+}
+
+void report_iteration(SearchContext& ctx, int depth, int move, int score)
+{
+    std::lock_guard<std::mutex> lock(ctx.shared->mutex);
+    if (depth > ctx.shared->depth)
+    {
+        ctx.shared->depth = depth;
+        ctx.shared->move = move;
+        ctx.shared->score = score;
+    }
+}
+
+// one pass over the root moves with the window (alpha, beta), searched like any other node.
+// returns the best score, best gets its move.
+template <int N>
+int search_root(SearchContext& ctx, const std::vector<int>& moves, int depth, int alpha, int beta, int& best)
+{
+    Board& b = ctx.board;
+    int best_score = -SCORE_INF;
+    best = moves[0];
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        int move = moves[i];
+        bool captured = apply_move(b, move) > 0;
+        ctx.stats.applied++;
+        int score;
+        if (i == 0)
+        {
+            score = search_child<N>(ctx, depth - 1, 1, alpha, beta, true, captured);
+        }
+        else
+        {
+            score = search_child<N>(ctx, depth - 1, 1, alpha, alpha + 1, true, captured);
+            if (score > alpha && score < beta)
+            {
+                score = search_child<N>(ctx, depth - 1, 1, alpha, beta, true, captured);
+            }
+        }
+        undo_move(b, move);
+        if (ctx.shared->stopped)
+        {
+            break;
+        }
+        if (score > best_score)
+        {
+            best_score = score;
+            best = move;
+        }
+        alpha = std::max(alpha, score);
+        if (alpha >= beta)
+        {
+            break;
+        }
+    }
+    return best_score;
+}
+
+// one thread's deepening loop over the root moves. helpers start every other thread one ply
+// deeper so the threads spread over neighbouring depths instead of repeating the same work.
+template <int N>
+void search_iterations(SearchContext& ctx, std::vector<int>& moves, int thread_id, Clock::time_point start, long long budget)
+{
+    Board& b = ctx.board;
+    ctx.clear_killers();
+
+    int max_depth = avlbl_lines<N>(b); // past this every line is drawn and the search is exact
+    if (ctx.config.depth_limit > 0)
+    {
+        max_depth = std::min(max_depth, ctx.config.depth_limit);
+    }
+    int score = 0;
+    for (int depth = 1 + thread_id % 2; depth <= max_depth; ++depth)
+    {
+        // aspiration: expect this iteration to land near the last one, and widen the side that
+        // fails until the score falls inside the window
+        int delta = ASPIRATION_WINDOW;
+        int alpha = -SCORE_INF;
+        int beta = SCORE_INF;
+        if (depth > 1 + thread_id % 2)
+        {
+            alpha = std::max(-SCORE_INF, score - delta);
+            beta = std::min(SCORE_INF, score + delta);
+        }
+        int iteration_best = moves[0];
+        while (true)
+        {
+            int result = search_root<N>(ctx, moves, depth, alpha, beta, iteration_best);
+            if (ctx.shared->stopped)
+            {
+                break;
+            }
+            delta *= 2;
+            if (result <= alpha)
+            {
+                alpha = std::max(-SCORE_INF, result - delta);
+            }
+            else if (result >= beta)
+            {
+                beta = std::min(SCORE_INF, result + delta);
+            }
+            else
+            {
+                score = result;
+                break;
+            }
+        }
+        if (ctx.shared->stopped)
+        {
+            break;
+        }
+        report_iteration(ctx, depth, iteration_best, score);
+        auto it = std::find(moves.begin(), moves.end(), iteration_best);
+        std::rotate(moves.begin(), it, it + 1);
+
+        // the next iteration costs several times this one, don't start what can't finish
+        long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+        if (thread_id == 0 && elapsed * 2 > budget)
+        {
+            break;
+        }
+    }
+    if (thread_id == 0)
+    {
+        // the main thread decides when the move is over
+        ctx.shared->stopped = true;
+    }
+    else
+    {
+        std::lock_guard<std::mutex> lock(ctx.shared->mutex);
+        add_stats(ctx.shared->helper_stats, ctx.stats);
+    }
+}
+
+// searches depth 1, 2, 3... until the move budget runs out and returns the best move of the
+// deepest iteration that finished. moves is reordered so the current best is searched first.
+int iterative_deepening(SearchContext& ctx, std::vector<int>& moves)
+{
+    Board& b = ctx.board;
+    moves.resize(drop_equivalent_moves(b, moves.data(), moves.size()));
+    // moves that a symmetry of the position maps onto each other lead to the same game, keep the
+    // lowest edge of each group. a symmetry maps the lines of a chain onto those of another, so
+    // the lowest of all of them is still there after both passes.
+    std::vector<int> stabilizer;
+    for (int k = 1; k < sym_count; ++k)
+    {
+        if (b.sym_hash[k] == b.board_hash && symmetric_under(b, k))
+        {
+            stabilizer.push_back(k);
+        }
+    }
+    moves.erase(std::remove_if(moves.begin(), moves.end(), [&stabilizer](int move) {
+        for (int k : stabilizer)
+        {
+            if (sym_edge[k][move] < move)
+            {
+                return true;
+            }
+        }
+        return false;
+    }), moves.end());
+
+    Clock::time_point start = Clock::now();
+    long long budget = move_budget_ms(ctx);
+    ctx.shared->deadline = start + std::chrono::milliseconds(budget);
+    ctx.shared->stopped = false;
+    ctx.shared->depth = 0;
+    ctx.shared->move = moves[0];
+    for (int e = 0; e < MAX_EDGE_ID; ++e)
+    {
+        ctx.history[e] /= 4; // keep some of what earlier turns learned
+    }
+
+    // order the root list once, after that the previous best leads each iteration. the killers of
+    // the last search belong to another position
+    ctx.clear_killers();
+    std::vector<int> keys(moves.size());
+    score_moves<0>(ctx, moves.data(), keys.data(), moves.size(), -1, 0);
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        pick_move(moves.data(), keys.data(), moves.size(), i);
+    }
+
+    std::vector<std::thread> helpers;
+    for (int id = 1; id < ctx.config.threads; ++id)
+    {
+        // each helper searches a copy of the root from its own context and walks the root list from
+        // a different offset, only the table and the shared results are common
+        std::shared_ptr<SearchContext> helper(new SearchContext);
+        helper->board = ctx.board;
+        helper->config = ctx.config;
+        helper->tt = ctx.tt;
+        helper->shared = ctx.shared;
+        std::vector<int> helper_moves = moves;
+        std::rotate(helper_moves.begin(), helper_moves.begin() + id % helper_moves.size(), helper_moves.end());
+        helpers.emplace_back([helper, helper_moves, id, start, budget]() mutable {
+            dispatch_board_size([&](auto size) {
+                search_iterations<decltype(size)::value>(*helper, helper_moves, id, start, budget);
+            });
+        });
+    }
+    dispatch_board_size([&](auto size) {
+        search_iterations<decltype(size)::value>(ctx, moves, 0, start, budget);
+    });
+    for (std::thread& helper : helpers)
+    {
+        helper.join();
+    }
+    return ctx.shared->move;
+}
+
+// exploration constant of the uct formula, for rewards between 0 and 1
+const double MCTS_EXPLORATION = 0.7;
+
+// hands out count nodes in a row, -1 when the pool is full
+int mcts_alloc(MctsTree& tree, int count)
+{
+    int first = tree.used.fetch_add(count);
+    if (first + count > tree.capacity)
+    {
+        return -1;
+    }
+    return first;
+}
+
+void mcts_init_node(MctsNode& node, int move, State mover)
+{
+    node.move = move;
+    node.mover = mover;
+    node.first_child = -1;
+    node.child_count = 0;
+    node.state.store(MCTS_LEAF, std::memory_order_relaxed);
+    node.visits.store(0, std::memory_order_relaxed);
+    node.reward.store(0, std::memory_order_relaxed);
+}
+
+// the children of an expanded node by uct. a child nobody has visited goes first; since visits are
+// counted on the way down, the next thread through already sees it as visited and picks another.
+int mcts_select(const MctsTree& tree, const MctsNode& node)
+{
+    double log_parent = std::log((double)std::max(1, node.visits.load(std::memory_order_relaxed)));
+    int best = node.first_child;
+    double best_value = -1;
+    for (int i = node.first_child; i < node.first_child + node.child_count; ++i)
+    {
+        const MctsNode& child = tree.nodes[i];
+        int visits = child.visits.load(std::memory_order_relaxed);
+        if (visits == 0)
+        {
+            return i;
+        }
+        double value = child.reward.load(std::memory_order_relaxed) / (2.0 * visits)
+                       + MCTS_EXPLORATION * std::sqrt(log_parent / visits);
+        if (value > best_value)
+        {
+            best_value = value;
+            best = i;
+        }
+    }
+    return best;
+}
+
+// one playout from the position on ctx.board with `to_move` to move, by the rule winning_move()
+// plays by: take a box when there is one, else a random safe line, else any random line. once only
+// chains and loops are left the solver finishes it exactly. returns the final margin for the ai.
+template <int N>
+int mcts_playout(SearchContext& ctx, State to_move, uint64_t& rng)
+{
+    Board& b = ctx.board;
+    int* moves = ctx.move_stack[0];
+    int* drawn = ctx.move_stack[1];
+    int count = 0;
+    int margin;
+    while (true)
+    {
+        if (game_state<N>(b))
+        {
+            margin = b.bot_score - b.opp_score;
+            break;
+        }
+        if (solvable_endgame(b))
+        {
+            int rest = solve_endgame(ctx, nullptr);
+            margin = b.bot_score - b.opp_score + (to_move == AI ? rest : -rest);
+            break;
+        }
+        int n = move_gen<N>(b, moves);
+        EdgeSet capture;
+        EdgeSet unsafe;
+        line_classes<N>(b, capture, unsafe);
+        int pick = -1;
+        int safe = 0;
+        for (int i = 0; i < n && pick < 0; ++i)
+        {
+            uint32_t bit = 1u << (moves[i] % ROW_BITS);
+            if (capture.row[moves[i] / ROW_BITS] & bit)
+            {
+                pick = moves[i];
+            }
+            else if (!(unsafe.row[moves[i] / ROW_BITS] & bit))
+            {
+                moves[safe++] = moves[i];
+            }
+        }
+        if (pick < 0)
+        {
+            pick = safe > 0 ? moves[splitmix64(rng) % safe] : moves[splitmix64(rng) % n];
+        }
+        b.turn = to_move;
+        if (apply_move(b, pick) == 0)
+        {
+            to_move = (to_move == AI) ? HUMAN : AI;
+        }
+        drawn[count++] = pick;
+    }
+    ctx.stats.applied += count;
+    while (count > 0)
+    {
+        undo_move(b, drawn[--count]);
+    }
+    return margin;
+}
+
+// one thread's share of the search: walk down the tree by uct, grow it by one node's children,
+// play out from there and count the result in every node on the way back up. repeats until the
+// deadline.
+template <int N>
+void mcts_iterations(SearchContext& ctx, MctsTree& tree, int thread_id)
+{
+    Board& b = ctx.board;
+    uint64_t rng = b.board_hash ^ (0x9E3779B97F4A7C15ULL * (thread_id + 1));
+    int path[MAX_MOVES + 1];
+    int deepest = 0;
+    State original_turn = b.turn;
+    while (!ctx.shared->stopped)
+    {
+        if ((ctx.stats.nodes & 15) == 0 && Clock::now() >= ctx.shared->deadline)
+        {
+            ctx.shared->stopped = true;
+            break;
+        }
+        ctx.stats.nodes++;
+
+        int length = 0;
+        int index = 0;
+        State to_move = AI;
+        tree.nodes[0].visits.fetch_add(1, std::memory_order_relaxed);
+        path[length++] = 0;
+        bool grown = false;
+        while (!grown)
+        {
+            MctsNode& node = tree.nodes[index];
+            int state = node.state.load(std::memory_order_acquire);
+            if (state == MCTS_LEAF && !game_state<N>(b) && !solvable_endgame(b)
+                && node.state.compare_exchange_strong(state, MCTS_EXPANDING))
+            {
+                int* moves = ctx.move_stack[0];
+                int count = drop_equivalent_moves<N>(b, moves, move_gen<N>(b, moves));
+                int first = mcts_alloc(tree, count);
+                if (first < 0)
+                {
+                    // out of nodes: the tree stops growing here, playouts go on
+                    break;
+                }
+                for (int i = 0; i < count; ++i)
+                {
+                    mcts_init_node(tree.nodes[first + i], moves[i], to_move);
+                }
+                node.first_child = first;
+                node.child_count = count;
+                node.state.store(MCTS_EXPANDED, std::memory_order_release);
+                ctx.stats.expanded++;
+                state = MCTS_EXPANDED;
+                grown = true;  // one new node per playout, the playout starts at one of its children
+            }
+            if (state != MCTS_EXPANDED)
+            {
+                break;
+            }
+            index = mcts_select(tree, node);
+            MctsNode& child = tree.nodes[index];
+            child.visits.fetch_add(1, std::memory_order_relaxed);
+            path[length++] = index;
+            b.turn = child.mover;
+            if (apply_move(b, child.move) == 0)
+            {
+                to_move = (child.mover == AI) ? HUMAN : AI;
+            }
+            ctx.stats.applied++;
+        }
+
+        int margin = mcts_playout<N>(ctx, to_move, rng);
+        for (int i = length - 1; i >= 0; --i)
+        {
+            MctsNode& node = tree.nodes[path[i]];
+            int result = (node.mover == AI) ? margin : -margin;
+            node.reward.fetch_add(result > 0 ? 2 : (result == 0 ? 1 : 0), std::memory_order_relaxed);
+            if (i > 0)
+            {
+                undo_move(b, node.move);
+            }
+        }
+        deepest = std::max(deepest, length - 1);
+    }
+    b.turn = original_turn;
+
+    std::lock_guard<std::mutex> lock(ctx.shared->mutex);
+    ctx.shared->depth = std::max(ctx.shared->depth, deepest);
+    if (thread_id != 0)
+    {
+        add_stats(ctx.shared->helper_stats, ctx.stats);
+    }
+}
+
+// monte carlo tree search over the root moves with the ai to move, in the memory --hash gives the
+// transposition table under alphabeta. the threads grow one tree; the move played is the root
+// child visited most.
+int mcts_search(SearchContext& ctx, std::vector<int>& moves)
+{
+    if (!ctx.tree)
+    {
+        ctx.tree.reset(new MctsTree);
+        ctx.tree->capacity = std::max<size_t>(1024, ctx.config.hash_mb * 1024 * 1024 / sizeof(MctsNode));
+        ctx.tree->nodes.reset(new MctsNode[ctx.tree->capacity]);
+    }
+    MctsTree& tree = *ctx.tree;
+    moves.resize(drop_equivalent_moves(ctx.board, moves.data(), moves.size()));
+
+    // the root is node 0 with its children right behind it
+    tree.used = 1 + moves.size();
+    mcts_init_node(tree.nodes[0], -1, HUMAN);
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        mcts_init_node(tree.nodes[1 + i], moves[i], AI);
+    }
+    tree.nodes[0].first_child = 1;
+    tree.nodes[0].child_count = moves.size();
+    tree.nodes[0].state.store(MCTS_EXPANDED, std::memory_order_release);
+
+    long long budget = move_budget_ms(ctx);
+    ctx.shared->deadline = Clock::now() + std::chrono::milliseconds(budget);
+    ctx.shared->stopped = moves.size() == 1;
+    ctx.shared->depth = 0;
+
+    std::vector<std::thread> helpers;
+    for (int id = 1; id < ctx.config.threads; ++id)
+    {
+        std::shared_ptr<SearchContext> helper(new SearchContext);
+        helper->board = ctx.board;
+        helper->config = ctx.config;
+        helper->shared = ctx.shared;
+        helpers.emplace_back([helper, &tree, id]() {
+            dispatch_board_size([&](auto size) {
+                mcts_iterations<decltype(size)::value>(*helper, tree, id);
+            });
+        });
+    }
+    dispatch_board_size([&](auto size) {
+        mcts_iterations<decltype(size)::value>(ctx, tree, 0);
+    });
+    for (std::thread& helper : helpers)
+    {
+        helper.join();
+    }
+
+    const MctsNode& root = tree.nodes[0];
+    int best = root.first_child;
+    for (int i = root.first_child; i < root.first_child + root.child_count; ++i)
+    {
+        if (tree.nodes[i].visits > tree.nodes[best].visits)
+        {
+            best = i;
+        }
+    }
+    ctx.shared->move = tree.nodes[best].move;
+    return ctx.shared->move;
+}
+
+// pondering: while the opponent thinks, search the position after our move with them to move.
+// nothing it finds is played directly, but the table ends up holding every reply a few plies
+// deep, so the search of our next turn finds its shallow iterations already done and goes deeper
+// in the same budget. runs until the main thread sets stopped.
+template <int N>
+void ponder_search(SearchContext& ctx)
+{
+    Board& b = ctx.board;
+    ctx.clear_killers();
+    ctx.shared->deadline = Clock::time_point::max();
+    int max_depth = std::min(avlbl_lines<N>(b), MAX_PLY - 1);
+    for (int depth = 1; depth <= max_depth && !ctx.shared->stopped; ++depth)
+    {
+        negamax<N>(ctx, depth, 0, -SCORE_INF, SCORE_INF, false);
+        if (!ctx.shared->stopped)
+        {
+            ctx.shared->depth = depth;
+        }
+    }
+}
+
+// starts pondering on ctx.board, which already holds our move, with the opponent to move.
+// returns false when the game is over.
+bool start_ponder(SearchContext& ctx, std::unique_ptr<SearchContext>& ponder, std::thread& worker)
+{
+    // the tree search starts from scratch every move, there is nothing to prepare for it
+    if (game_state(ctx.board) || ctx.config.engine == ENGINE_MCTS)
+    {
+        return false;
+    }
+    // store under the age of the search that follows, so its shallow entries can't evict these
+    ctx.tt->age++;
+    ctx.table_aged = true;
+    ponder.reset(new SearchContext);
+    ponder->board = ctx.board;
+    ponder->config = ctx.config;
+    ponder->tt = ctx.tt;
+    ponder->board.turn = HUMAN;
+    SearchContext* search = ponder.get();
+    worker = std::thread([search]() {
+        dispatch_board_size([&](auto size) {
+            ponder_search<decltype(size)::value>(*search);
+        });
+    });
+    return true;
+}
+
+// stops pondering and returns the depth it completed
+int stop_ponder(std::unique_ptr<SearchContext>& ponder, std::thread& worker)
+{
+    if (!worker.joinable())
+    {
+        return 0;
+    }
+    ponder->shared->stopped = true;
+    worker.join();
+    return ponder->shared->depth;
+}
+
+// opening book: positions from the first few lines of a game, each searched deeply offline by
+// book_build() and stored as canonical hash -> best move in the canonical orientation, sorted by
+// hash. the file is mapped as is, so loading costs nothing and a probe is a binary search.
+struct BookHeader {
+    char magic[8];
+    uint32_t board_size;
+    uint32_t count;
+};
+struct BookEntry {
+    uint64_t key;
+    uint32_t move;
+    uint32_t depth;
+};
+const char BOOK_MAGIC[8] = {'D', 'B', 'B', 'O', 'O', 'K', '1', 0};
+
+// the mapped book, read only and shared by every search like the geometry
+const BookEntry* book_entries = nullptr;
+size_t book_count = 0;
+
+// maps the book for the current board size. a missing file, or one built for another size, leaves
+// the engine without a book.
+bool book_load(const std::string& path)
+{
+    size_t size;
+    const char* data = map_file(path, size);
+    if (!data)
+    {
+        return false;
+    }
+    const BookHeader* header = (const BookHeader*)data;
+    if (size < sizeof(BookHeader)
+        || std::memcmp(header->magic, BOOK_MAGIC, sizeof(BOOK_MAGIC)) != 0
+        || (int)header->board_size != rows - 1
+        || sizeof(BookHeader) + header->count * sizeof(BookEntry) > size)
+    {
+        munmap((void*)data, size);
+        return false;
+    }
+    book_entries = (const BookEntry*)(header + 1);
+    book_count = header->count;
+    return true;
+}
+
+// the book move for this position, -1 when it isn't in the book
+int book_probe(const Board& b)
+{
+    if (book_count == 0)
+    {
+        return -1;
+    }
+    int sym;
+    uint64_t key = canonical_hash(b, sym);
+    const BookEntry* end = book_entries + book_count;
+    const BookEntry* it = std::lower_bound(book_entries, end, key, [](const BookEntry& entry, uint64_t k) {
+        return entry.key < k;
+    });
+    if (it == end || it->key != key)
+    {
+        return -1;
+    }
+    int move = sym_edge[sym_inverse[sym]][it->move];
+    return has_line(b, move) ? -1 : move;
+}
+
+// bench/tablebase.cpp: every set of chains (length 1 and up) and loops (even length 4 and up) with
+// at most max_boxes boxes, solved and written to path. returns the number of entries.
+size_t tablebase_build(int max_boxes, const std::string& path)
+{
+    std::unique_ptr<SearchContext> ctx(new SearchContext);
+    ctx->chain_memo.resize(CHAIN_MEMO_SLOTS << 6);  // every subset of every set gets solved
+    std::vector<TablebaseEntry> entries;
+    std::vector<int> codes;
+    // codes are added in non decreasing order, so every set is visited once, already sorted
+    auto visit = [&](auto&& self, int min_code, int boxes) -> void {
+        if (!codes.empty())
+        {
+            entries.push_back({component_key(codes), solve_components(*ctx, codes), boxes});
+        }
+        for (int code = min_code; boxes + code / 2 <= max_boxes; ++code)
+        {
+            int length = code / 2;
+            if ((code & 1) && (length < 4 || length % 2 != 0))
+            {
+                continue;
+            }
+            codes.push_back(code);
+            self(self, code, boxes + length);
+            codes.pop_back();
+        }
+    };
+    visit(visit, 2, 0);
+
+    std::sort(entries.begin(), entries.end(), [](const TablebaseEntry& x, const TablebaseEntry& y) {
+        return x.key < y.key;
+    });
+    TablebaseHeader header;
+    std::memcpy(header.magic, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC));
+    header.max_boxes = max_boxes;
+    header.count = entries.size();
+    std::ofstream out(path, std::ios::binary);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)entries.data(), entries.size() * sizeof(TablebaseEntry));
+    return out ? entries.size() : 0;
+}
+
+// bench/book.cpp: every position with up to `plies` lines and no box open to capture, one per
+// symmetry class, searched to `depth` and written to path. returns the number of entries.
+size_t book_build(int board_size, int plies, int depth, int threads, const std::string& path)
+{
+    rows = board_size + 1;
+    columns = board_size + 1;
+    default_arr();
+    init_zobrist();
+    tt_resize(main_table, 256);
+    std::unique_ptr<SearchContext> ctx(new SearchContext);
+    ctx->config.depth_limit = depth;
+    ctx->config.move_time_ms = std::numeric_limits<int>::max();
+    ctx->config.threads = threads;
+    Board& b = ctx->board;
+    clear_board(b);
+    rehash(b);
+    recount_sides(b);
+
+    std::vector<BookEntry> entries;
+    std::unordered_set<uint64_t> seen;
+    std::vector<int> all(MAX_MOVES);
+    all.resize(move_gen(b, all.data()));
+    // lines are added in increasing edge order, so every set of lines is visited once
+    auto visit = [&](auto&& self, size_t next, int drawn) -> void {
+        int sym;
+        uint64_t key = canonical_hash(b, sym);
+        if (b.sided_boxes[3] > 0 || !seen.insert(key).second)
+        {
+            return;
+        }
+        b.turn = AI;
+        ctx->tt->age++;
+        std::vector<int> moves(MAX_MOVES);
+        moves.resize(move_gen(b, moves.data()));
+        int best = iterative_deepening(*ctx, moves);
+        entries.push_back({key, (uint32_t)sym_edge[sym][best], (uint32_t)ctx->shared->depth});
+        if (drawn == plies)
+        {
+            return;
+        }
+        for (size_t i = next; i < all.size(); ++i)
+        {
+            apply_move(b, all[i]);
+            self(self, i + 1, drawn + 1);
+            undo_move(b, all[i]);
+        }
+    };
+    visit(visit, 0, 0);
+
+    std::sort(entries.begin(), entries.end(), [](const BookEntry& x, const BookEntry& y) {
+        return x.key < y.key;
+    });
+    BookHeader header;
+    std::memcpy(header.magic, BOOK_MAGIC, sizeof(BOOK_MAGIC));
+    header.board_size = board_size;
+    header.count = entries.size();
+    std::ofstream out(path, std::ios::binary);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)entries.data(), entries.size() * sizeof(BookEntry));
+    return out ? entries.size() : 0;
+}
+
+Move winning_move(SearchContext& ctx)
+{
+    Board& b = ctx.board;
+    b.turn = AI;
+    if (!ctx.table_aged)
+    {
+        ctx.tt->age++;
+    }
+    ctx.table_aged = false;
+    ctx.stats = SearchStats();
+    ctx.shared->helper_stats = SearchStats();
+    ctx.shared->depth = 0;
+    ctx.move_branch = "none";
+    ctx.move_scored = false;
+    std::vector<int> available_moves(MAX_MOVES);
+    available_moves.resize(move_gen(b, available_moves.data()));
+
+    if (available_moves.empty())
+    {
+        return {};
+    }
+
+    if (solvable_endgame(b))
+    {
+        int endgame = available_moves[0];
+        ctx.move_score = A * (b.bot_score - b.opp_score + solve_endgame(ctx, &endgame));
+        ctx.move_scored = true;
+        ctx.move_branch = "endgame";
+        return edge_move(endgame);
+    }
+
+    int book_move = book_probe(b);
+    if (book_move >= 0)
+    {
+        ctx.move_branch = "book";
+        return edge_move(book_move);
+    }
+
+    // capturing and unsafe lines for the whole board at once, from the two and three sided boxes
+    // the board keeps up to date. the first of each in move_gen() order is the one played.
+    EdgeSet capture_lines;
+    EdgeSet unsafe_lines;
+    line_classes(b, capture_lines, unsafe_lines);
+    int capture = -1;
+    int safe = -1;
+    for (int slot = 0; slot < EDGE_SLOTS && capture < 0; ++slot)
+    {
+        uint32_t free_bits;
+        if (slot < V_BASE)
+        {
+            if (slot >= rows)
+            {
+                continue;
+            }
+            free_bits = ~b.lines.row[slot] & h_mask;
+        }
+        else
+        {
+            if (slot - V_BASE >= rows - 1)
+            {
+                break;
+            }
+            free_bits = ~b.lines.row[slot] & v_mask;
+        }
+        if (free_bits & capture_lines.row[slot])
+        {
+            capture = slot * ROW_BITS + __builtin_ctz(free_bits & capture_lines.row[slot]);
+        }
+        else if (safe < 0 && (free_bits & ~unsafe_lines.row[slot]))
+        {
+            safe = slot * ROW_BITS + __builtin_ctz(free_bits & ~unsafe_lines.row[slot]);
+        }
+    }
+    if (capture >= 0)
+    {
+        ctx.move_branch = "capture";
+        return edge_move(capture);
+    }
+    if (safe >= 0)
+    {
+        ctx.move_branch = "safe";
+        return edge_move(safe);
+    }
+
+    ctx.move_branch = "search";
+    if (ctx.config.engine == ENGINE_MCTS)
+    {
+        return edge_move(mcts_search(ctx, available_moves));
+    }
+    int best = iterative_deepening(ctx, available_moves);
+    ctx.move_scored = ctx.shared->depth > 0;
+    ctx.move_score = ctx.shared->score;
+    return edge_move(best);
+}
+
+string translate(const Move& move)
+{
+    const int total_box_rows = rows - 1;
+    string box_name;
+    string side_char;
+
+    if (move.type == HORIZONTAL)
+    {
+        if (move.r < total_box_rows)
+        {
+            box_name = string(1, 'A' + move.c) + to_string(total_box_rows - move.r);
+            side_char = "T";
+        }
+        else
+        {
+            box_name = string(1, 'A' + move.c) + to_string(total_box_rows - (move.r - 1));
+            side_char = "B";
+        }
+    }
+    else
+    {
+        const int total_box_cols = columns - 1;
+        if (move.c < total_box_cols)
+        {
+            box_name = string(1, 'A' + move.c) + to_string(total_box_rows - move.r);
+            side_char = "L";
+        }
+        else
+        {
+            box_name = string(1, 'A' + (move.c - 1)) + to_string(total_box_rows - move.r);
+            side_char = "R";
+        }
+    }
+    return box_name + " " + side_char;
+}
+
+// turn input is scanned straight out of the stream buffer of std::cin: no operator>>, no string
+// per token. skip_blanks() leaves the next character in the buffer and returns it.
+int skip_blanks(std::streambuf* in)
+{
+    int ch = in->sgetc();
+    while (ch == ' ' || ch == '\n' || ch == '\r' || ch == '\t')
+    {
+        ch = in->snextc();
+    }
+    return ch;
+}
 
-void default_arr()
+int read_number(std::streambuf* in)
 {
-    horizontal_lines.clear();
-    vertical_lines.clear();
-    box_owners.clear();
-    horizontal_lines.resize(rows, std::vector<bool>(columns - 1, false));
-    vertical_lines.resize(rows - 1, std::vector<bool>(columns, false));
-    box_owners.resize(rows - 1, std::vector<int>(columns - 1, NO_OWNER));
+    int ch = skip_blanks(in);
+    int value = 0;
+    while (ch >= '0' && ch <= '9')
+    {
+        value = value * 10 + (ch - '0');
+        ch = in->snextc();
+    }
+    return value;
 }
 
-std::vector<Move> move_gen()
+// reads one turn: the scores, then every box that still misses sides as e.g. "B4 TR". the lines
+// are diffed against the board of the last turn, which already holds our own move: the new ones
+// are the opponent's and go through apply_move() so the hashes and side counts stay incremental.
+// the first turn, or a board that doesn't follow from the last one, is rebuilt in full. returns
+// false at the end of the input.
+bool parse_turn_input(Board& b)
 {
-    std::vector<Move> avlbl_moves;
-    avlbl_moves.reserve(2 * rows * columns);
-    for (int i = 0; i < rows; ++i)
+    std::streambuf* in = std::cin.rdbuf();
+    if (skip_blanks(in) == EOF)
+    {
+        return false;
+    }
+    int bot_score = read_number(in);
+    int opp_score = read_number(in);
+    int num_boxes = read_number(in);
+
+    EdgeSet seen;
+    for (int i = 0; i < EDGE_SLOTS; ++i)
     {
-        for (int j = 0; j < columns - 1; ++j)
+        seen.row[i] = 0;
+    }
+    for (int r = 0; r < rows; ++r)
+    {
+        seen.row[r] = h_mask;
+    }
+    for (int r = 0; r < rows - 1; ++r)
+    {
+        seen.row[V_BASE + r] = v_mask;
+    }
+
+    for (int i = 0; i < num_boxes; i++)
+    {
+        int box_c = skip_blanks(in) - 'A';
+        in->sbumpc();
+        int box_r = (rows - 1) - read_number(in);
+        for (int side = skip_blanks(in); side >= 'A' && side <= 'Z'; side = in->snextc())
         {
-            if (!horizontal_lines[i][j])
+            if (side == 'T')
+            {
+                seen.row[box_r] &= ~(1u << box_c);
+            }
+            else if (side == 'B')
+            {
+                seen.row[box_r + 1] &= ~(1u << box_c);
+            }
+            else if (side == 'L')
+            {
+                seen.row[V_BASE + box_r] &= ~(1u << box_c);
+            }
+            else if (side == 'R')
             {
-                avlbl_moves.push_back({i, j, HORIZONTAL});
+                seen.row[V_BASE + box_r] &= ~(1u << (box_c + 1));
             }
         }
     }
-    for (int i = 0; i < rows - 1; ++i)
+
+    bool follows = false;
+    for (int i = 0; i < EDGE_SLOTS; ++i)
+    {
+        if (b.lines.row[i] & ~seen.row[i])
+        {
+            follows = false;
+            break;
+        }
+        follows |= b.lines.row[i] != 0;
+    }
+    if (follows)
     {
-        for (int j = 0; j < columns; ++j)
+        b.turn = HUMAN;
+        for (int i = 0; i < EDGE_SLOTS; ++i)
         {
-            if (!vertical_lines[i][j])
+            for (uint32_t added = seen.row[i] & ~b.lines.row[i]; added; added &= added - 1)
             {
-                avlbl_moves.push_back({i, j, VERTICAL});
+                apply_move(b, i * ROW_BITS + __builtin_ctz(added));
             }
         }
     }
-    return avlbl_moves;
+    else
+    {
+        // nothing carries over from the old board, boxes it owned included
+        clear_board(b);
+        b.lines = seen;
+        rehash(b);
+        recount_sides(b);
+    }
+    // the input has the final word on the score
+    b.bot_score = bot_score;
+    b.opp_score = opp_score;
+    return true;
+}
+
+// one json line per move on stderr, stdout belongs to the protocol
+void report_telemetry(SearchContext& ctx, int move_number, const std::string& move, long long elapsed_ms)
+{
+    SearchStats total = ctx.stats;
+    add_stats(total, ctx.shared->helper_stats);
+    double cutoff_rate = total.expanded ? (double)total.cutoffs / total.expanded : 0;
+    double first_cutoff_rate = total.cutoffs ? (double)total.first_cutoffs / total.cutoffs : 0;
+    double ebf = ctx.shared->depth > 0 && total.nodes > 0 ? std::pow((double)total.nodes, 1.0 / ctx.shared->depth) : 0;
+    std::cerr << "{\"move_number\":" << move_number
+              << ",\"move\":\"" << move << "\""
+              << ",\"branch\":\"" << ctx.move_branch << "\""
+              << ",\"depth\":" << ctx.shared->depth
+              << ",\"score\":" << (ctx.move_scored ? std::to_string(ctx.move_score) : "null")
+              << ",\"nodes\":" << total.nodes
+              << ",\"qnodes\":" << total.qnodes
+              << ",\"applied\":" << total.applied
+              << ",\"expanded\":" << total.expanded
+              << ",\"cutoffs\":" << total.cutoffs
+              << ",\"cutoff_rate\":" << cutoff_rate
+              << ",\"first_move_cutoff_rate\":" << first_cutoff_rate
+              << ",\"tt_probes\":" << total.tt_probes
+              << ",\"tt_hits\":" << total.tt_hits
+              << ",\"ebf\":" << ebf
+              << ",\"elapsed_ms\":" << elapsed_ms
+              << ",\"threads\":" << ctx.config.threads
+              << ",\"ponder_depth\":" << ctx.ponder_depth
+              << "}" << std::endl;
+}
+
+// bench/bench.cpp drives the engine through these two: load a position from the turn input on
+// std::cin with an empty table, then search it to a fixed depth and report the move and node count
+static std::unique_ptr<SearchContext> bench_context;
+
+void bench_load(int board_size)
+{
+    rows = board_size + 1;
+    columns = board_size + 1;
+    default_arr();
+    init_zobrist();
+    bench_context.reset(new SearchContext);
+    tt_resize(*bench_context->tt, bench_context->config.hash_mb);
+    parse_turn_input(bench_context->board);
 }
 
-double eval_board()
+std::string bench_search(int depth, uint64_t& nodes)
 {
-    double p1 = A * (bot_score - opp_score);
-    int three_sides = 0;
-    int two_sides = 0;
-    int one_sides = 0;
-    for (int r = 0; r < rows - 1; r++)
+    SearchContext& ctx = *bench_context;
+    ctx.board.turn = AI;
+    ctx.config.depth_limit = depth;
+    ctx.config.move_time_ms = std::numeric_limits<int>::max();
+    std::vector<int> moves(MAX_MOVES);
+    moves.resize(move_gen(ctx.board, moves.data()));
+    nodes = 0;
+    if (moves.empty())
     {
-        for (int c = 0; c < columns - 1; c++)
-        { 
-            int count = count_sides(r,c);
-            if (count == 3)
-            {
-                three_sides++;
-            }
-            if (count == 2)
-              two_sides++;
-            if (count == 1)
-              one_sides++;
-        }
+        return "-";
     }
-    double p2 = 5 * three_sides;
-    double p3 = 1 * two_sides;
-    int p4 = 0.5 * one_sides;
-    // if ((bot_score - opp_score) > 30) {
-    //   return p1 - p2;
-    // }
+    int best = iterative_deepening(ctx, moves);
+    nodes = ctx.stats.nodes + ctx.stats.qnodes;
+    return translate(edge_move(best));
+}
 
-    // improved heuristics, now assigns scores based on the number of sides that a box has completed
-    return p1 - p2 + p3 + p4;
+// the other player's point of view of the same position: the engine always plays as AI
+void swap_sides(Board& b)
+{
+    std::swap(b.bot_score, b.opp_score);
+    std::swap(b.owned[AI], b.owned[HUMAN]);
 }
 
-int apply_move(const Move& move)
+bool parse_options(const std::vector<std::string>& args, EngineConfig& options);
+
+// batch analysis: after the board size, stdin holds any number of turn inputs, one position each,
+// all with the ai to move. every position gets one line on stdout, in input order: the move, the
+// winning_move() branch that chose it, its score ("-" when nothing scored it) and the nodes
+// searched. the positions go to --threads workers, each searching one position at a time on one
+// thread with its own share of --hash; a worker's table and history carry over between its
+// positions like between the moves of a game. at most a few positions per worker are read ahead,
+// so memory stays bounded however long the input is. returns the number of positions.
+long run_batch(const EngineConfig& config)
 {
-    //  slightly improved the logic of checking, it now checks if a box has been completed with a function.
-    int boxed = 0;
-    if (move.type == HORIZONTAL)
-    {
-        horizontal_lines[move.r][move.c] = true;
-        if (move.r < rows - 1 && count_sides(move.r, move.c) == 4)
+    struct Job {
+        long index;
+        Board board;
+    };
+    int workers = std::max(1, config.threads);
+    size_t window = 4 * workers;   // positions read but not yet written
+    std::mutex mutex;
+    std::condition_variable has_job;
+    std::condition_variable has_room;
+    std::deque<Job> jobs;
+    std::map<long, std::string> finished;
+    long next_out = 0;
+    long read = 0;
+    bool end_of_input = false;
+
+    auto work = [&]() {
+        std::unique_ptr<SearchContext> ctx(new SearchContext);
+        TransTable table;
+        ctx->tt = &table;
+        ctx->config = config;
+        ctx->config.hash_mb = std::max<size_t>(1, config.hash_mb / workers);
+        ctx->config.threads = 1;
+        ctx->config.game_time_ms = 0;  // the positions don't share a clock
+        if (config.engine != ENGINE_MCTS)
         {
-            box_owners[move.r][move.c] = turn;
-            boxed++;
+            tt_resize(table, ctx->config.hash_mb);
         }
-        if (move.r > 0 && count_sides(move.r - 1, move.c) == 4)
+        while (true)
         {
-            box_owners[move.r - 1][move.c] = turn;
-            boxed++;
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                has_job.wait(lock, [&]() { return !jobs.empty() || end_of_input; });
+                if (jobs.empty())
+                {
+                    return;
+                }
+                job = jobs.front();
+                jobs.pop_front();
+            }
+            ctx->board = job.board;
+            std::string line = translate(winning_move(*ctx));
+            line += std::string(" ") + ctx->move_branch;
+            line += " " + (ctx->move_scored ? std::to_string(ctx->move_score) : std::string("-"));
+            line += " " + std::to_string(ctx->stats.nodes + ctx->stats.qnodes);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            finished[job.index] = line;
+            for (auto it = finished.find(next_out); it != finished.end(); it = finished.find(next_out))
+            {
+                std::cout << it->second << '\n';
+                finished.erase(it);
+                next_out++;
+            }
+            has_room.notify_one();
         }
+    };
+    std::vector<std::thread> pool;
+    for (int i = 0; i < workers; ++i)
+    {
+        pool.emplace_back(work);
     }
-    else
+
+    while (true)
     {
-        vertical_lines[move.r][move.c] = true;
-        if (move.c < columns - 1 && count_sides(move.r, move.c) == 4)
-        {
-            box_owners[move.r][move.c] = turn;
-            boxed++;
-        }
-        if (move.c > 0 && count_sides(move.r, move.c - 1) == 4) 
+        // every position is read into an empty board, parse_turn_input() rebuilds it in full
+        Board board = {};
+        if (!parse_turn_input(board))
         {
-            box_owners[move.r][move.c - 1] = turn;
-            boxed++;
+            break;
         }
+        std::unique_lock<std::mutex> lock(mutex);
+        has_room.wait(lock, [&]() { return (size_t)(read - next_out) < window; });
+        jobs.push_back({read++, board});
+        has_job.notify_one();
     }
-    if (boxed > 0)
     {
-        if (turn == AI)
+        std::lock_guard<std::mutex> lock(mutex);
+        end_of_input = true;
+    }
+    has_job.notify_all();
+    for (std::thread& worker : pool)
+    {
+        worker.join();
+    }
+    std::cout << std::flush;
+    return read;
+}
+
+// self play hooks for bench/arena.cpp. arena_setup() builds the board geometry once and checks the
+// options, after that any number of threads can play whole games with arena_game(). each side gets
+// its own options, in command line syntax, and its own context, table and clock; the first
+// `opening` lines are random safe ones drawn from seed, then side 0 moves.
+bool arena_setup(int board_size, const std::string options[2])
+{
+    for (int side = 0; side < 2; ++side)
+    {
+        std::istringstream words(options[side]);
+        std::vector<std::string> args((std::istream_iterator<std::string>(words)), std::istream_iterator<std::string>());
+        EngineConfig config;
+        if (!parse_options(args, config))
         {
-            bot_score += boxed;
+            std::cerr << "arena: bad options \"" << options[side] << "\"" << std::endl;
+            return false;
         }
-        else
+        // the book and the tablebase are mapped once for the whole process, not per side
+        if (!config.book.empty() || !config.tablebase.empty())
         {
-            opp_score += boxed;
+            std::cerr << "arena: --book and --tablebase are not supported in --a or --b" << std::endl;
+            return false;
         }
     }
-    return boxed;
+    rows = board_size + 1;
+    columns = board_size + 1;
+    default_arr();
+    init_zobrist();
+    return true;
 }
 
-void undo_move(const Move& move)
+void arena_game(const std::string options[2], int opening, uint64_t seed, int scores[2], long long think_us[2], int moves[2])
 {
-    int boxed_undone = 0;
-    if (move.type == HORIZONTAL)
+    static thread_local TransTable tables[2];
+    std::unique_ptr<SearchContext> contexts[2];
+    for (int side = 0; side < 2; ++side)
     {
-        if (move.r < rows - 1 && box_owners[move.r][move.c] != NO_OWNER)
-        {
-            box_owners[move.r][move.c] = NO_OWNER;
-            boxed_undone++;
-        }
-        if (move.r > 0 && box_owners[move.r - 1][move.c] != NO_OWNER)
+        contexts[side].reset(new SearchContext);
+        std::istringstream words(options[side]);
+        std::vector<std::string> args((std::istream_iterator<std::string>(words)), std::istream_iterator<std::string>());
+        parse_options(args, contexts[side]->config);  // arena_setup() already checked them
+        contexts[side]->tt = &tables[side];
+        if (contexts[side]->config.engine != ENGINE_MCTS)
         {
-            box_owners[move.r - 1][move.c] = NO_OWNER;
-            boxed_undone++;
+            tt_resize(tables[side], contexts[side]->config.hash_mb);
         }
-        horizontal_lines[move.r][move.c] = false;
+        think_us[side] = 0;
+        moves[side] = 0;
     }
-    else
+
+    // the game is played out on b, each side searches its own copy of it
+    Board b = {};
+    clear_board(b);
+    rehash(b);
+    recount_sides(b);
+    int side = 0;
+    int free_moves[MAX_MOVES];
+    for (int i = 0; i < opening; ++i)
     {
-        if (move.c < columns - 1 && box_owners[move.r][move.c] != NO_OWNER)
+        int count = move_gen(b, free_moves);
+        int safe = 0;
+        for (int j = 0; j < count; ++j)
         {
-            box_owners[move.r][move.c] = NO_OWNER;
-            boxed_undone++;
+            if (is_safe(b, free_moves[j]))
+            {
+                free_moves[safe++] = free_moves[j];
+            }
         }
-        if (move.c > 0 && box_owners[move.r][move.c - 1] != NO_OWNER)
+        if (safe == 0)
         {
-            box_owners[move.r][move.c - 1] = NO_OWNER;
-            boxed_undone++;
+            break;
         }
-        vertical_lines[move.r][move.c] = false;
+        b.turn = AI;
+        apply_move(b, free_moves[splitmix64(seed) % safe]);
+        swap_sides(b);
+        side ^= 1;
     }
-    if (boxed_undone > 0)
+
+    while (!game_state(b))
     {
-        if (turn == AI)
-        {
-            bot_score -= boxed_undone;
-        }
-        else
+        SearchContext& ctx = *contexts[side];
+        ctx.board = b;
+        Clock::time_point start = Clock::now();
+        Move move = winning_move(ctx);
+        long long elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+        think_us[side] += elapsed;
+        ctx.game_time_used += elapsed / 1000;
+        moves[side]++;
+
+        b.turn = AI;
+        int edge = move_edge(move);
+        if (apply_move(b, edge) == 0)
         {
-            opp_score -= boxed_undone;
+            swap_sides(b);
+            side ^= 1;
         }
     }
+    scores[side] = b.bot_score;
+    scores[side ^ 1] = b.opp_score;
 }
 
-bool game_state()
+// every line played out, memoized up to symmetry: the exact net boxes for the player to move
+int brute_force_endgame(Board& b, std::unordered_map<uint64_t, int>& memo)
 {
-    // checks if game has been completed
-    return (bot_score + opp_score == (rows - 1) * (columns - 1));
+    int sym;
+    uint64_t key = canonical_hash(b, sym);
+    auto found = memo.find(key);
+    if (found != memo.end())
+    {
+        return found->second;
+    }
+    int free_moves[MAX_MOVES];
+    int count = move_gen(b, free_moves);
+    int best = count ? -MAX_MOVES : 0;
+    for (int i = 0; i < count; ++i)
+    {
+        int taken = apply_move(b, free_moves[i]);
+        int value = taken ? taken + brute_force_endgame(b, memo) : -brute_force_endgame(b, memo);
+        undo_move(b, free_moves[i]);
+        best = std::max(best, value);
+    }
+    memo[key] = best;
+    return best;
 }
 
-double minimax(int depth, double alpha, double beta, bool maxim)
+// endgame solver check for bench/solver_check.cpp. every position plays random safe lines drawn
+// from seed until none are left and then up to seven random lines more; the solvable ones with at most
+// max_free lines left are solved by solve_endgame() and by brute force, and both the value and the
+// value of the line it chose must match. returns the number of positions compared, failed counts
+// the mismatches, which are also printed to std::cerr.
+int solver_check(int board_size, int positions, int max_free, uint64_t seed, int& failed)
 {
-    if (depth == 0 || game_state())
-    {
-        return eval_board();
-    }
-    if (maxim)
+    rows = board_size + 1;
+    columns = board_size + 1;
+    default_arr();
+    init_zobrist();
+    std::unique_ptr<SearchContext> ctx(new SearchContext);
+    Board& b = ctx->board;
+    std::unordered_map<uint64_t, int> memo;
+    int compared = 0;
+    failed = 0;
+    int free_moves[MAX_MOVES];
+    for (int position = 0; position < positions; ++position)
     {
-        double maxEval = -100000;
-        State original_turn = turn;
-        turn = AI;
-        for (const Move& move : move_gen())
+        clear_board(b);
+        rehash(b);
+        recount_sides(b);
+        b.turn = AI;
+        while (true)
         {
-            int boxed = apply_move(move);
-            double eval = (boxed > 0) ? minimax(depth - 1, alpha, beta, true) : minimax(depth - 1, alpha, beta, false);
-            undo_move(move);
-            maxEval = std::max(maxEval, eval);
-            alpha = std::max(alpha, eval);
-            if (beta <= alpha)
+            int count = move_gen(b, free_moves);
+            int safe = 0;
+            for (int j = 0; j < count; ++j)
+            {
+                if (is_safe(b, free_moves[j]))
+                {
+                    free_moves[safe++] = free_moves[j];
+                }
+            }
+            if (safe == 0)
             {
                 break;
             }
+            apply_move(b, free_moves[splitmix64(seed) % safe]);
         }
-        turn = original_turn;
-        return maxEval;
-    }
-    else
-    {
-        double minEval = 100000;
-        State original_turn = turn;
-        turn = HUMAN;
-        for (const Move& move : move_gen())
+        for (int extra = splitmix64(seed) % 8; extra > 0; --extra)
         {
-            int boxed = apply_move(move);
-            double eval = (boxed > 0) ? minimax(depth - 1, alpha, beta, false) : minimax(depth - 1, alpha, beta, true);
-            undo_move(move);
-            minEval = std::min(minEval, eval);
-            beta = std::min(beta, eval);
-            if (beta <= alpha)
+            int count = move_gen(b, free_moves);
+            if (count > 1)
             {
-                break;
+                apply_move(b, free_moves[splitmix64(seed) % count]);
             }
         }
-        turn = original_turn;
-        return minEval;
-    }
-}
-
-int count_sides(int r, int c)
-{
-    if (r < 0 || r >= rows - 1 || c < 0 || c >= columns - 1)
-    {
-        return 0;
-    }
-    int side_count = 0;
-    if (horizontal_lines[r][c]) side_count++;
-    if (horizontal_lines[r + 1][c]) side_count++;
-    if (vertical_lines[r][c]) side_count++;
-    if (vertical_lines[r][c + 1]) side_count++;
-    return side_count;
-}
-int avlbl_lines();
-
-int avlbl_lines() {
-    
-    // new function which tries and helps fix the timeouts in the endgame
-    // returns the count of number of available moves in the grid
-    int count = 0;
-    for (int i = 0; i < rows; ++i) {
-        for (int j = 0; j < columns - 1; ++j) {
-            if (!horizontal_lines[i][j]) {
-                count++;
-            }
+        // net values from here on
+        b.bot_score = 0;
+        b.opp_score = 0;
+        if (game_state(b) || !solvable_endgame(b) || move_gen(b, free_moves) > max_free)
+        {
+            continue;
         }
-    }
-    for (int i = 0; i < rows - 1; ++i) {
-        for (int j = 0; j < columns; ++j) {
-            if (!vertical_lines[i][j]) {
-                count++;
-            }
+        compared++;
+        memo.clear();
+        int exact = brute_force_endgame(b, memo);
+        int best_move = -1;
+        int solved = solve_endgame(*ctx, &best_move);
+        int taken = apply_move(b, best_move);
+        int played = taken ? taken + brute_force_endgame(b, memo) : -brute_force_endgame(b, memo);
+        undo_move(b, best_move);
+        if (solved != exact || played != exact)
+        {
+            failed++;
+            std::cerr << "position " << position << ": exact " << exact << ", solved " << solved
+                      << ", line " << translate(edge_move(best_move)) << " worth " << played << std::endl;
         }
     }
-    return count;
+    return compared;
 }
 
-Move winning_move()
+// side_masks() kernel check for bench/side_masks_check.cpp: random line sets of every density on a
+// board_size board, counted by the avx2 kernel and the scalar one. returns the number of boards
+// they disagree on, or -1 when the cpu has no avx2 to check.
+int side_masks_check(int board_size, int boards, uint64_t seed)
 {
-    turn = AI;
-    std::vector<Move> available_moves = move_gen();
-    std::vector<Move> safe_moves;
-
-    if (available_moves.empty())
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("avx2"))
     {
-        return {};
-    }
-
-    // new condition. if only 30 lines remain, it stops the minimax search and does a score comparison of all available moves left.
-    if (avlbl_lines() < 30) {
-      Move endgame = available_moves[0];
-      double best_eval = -100000;
-      for (const Move& move : available_moves) {
-        apply_move(move);
-        double eval = eval_board();
-        undo_move(move);
-        if (eval > best_eval) {
-          best_eval = eval;
-          endgame = move;
-        }
-      }
-      return endgame;
+        return -1;
     }
-    for (const Move& move : available_moves)
+    rows = board_size + 1;
+    columns = board_size + 1;
+    default_arr();
+    int failed = 0;
+    for (int board = 0; board < boards; ++board)
     {
-        int temp_bot_score = bot_score;
-        int boxed = apply_move(move);
-        bool creates_third_side = false;
-        
-        if (move.type == HORIZONTAL)
+        // up to three more random words anded or ored in, so boards range from nearly empty to
+        // nearly full
+        EdgeSet lines = {};
+        bool sparse = board % 2;
+        int rounds = board / 2 % 4;
+        for (int i = 0; i < rows; ++i)
         {
-            if (move.r < rows - 1 && count_sides(move.r, move.c) == 3)
+            uint64_t h = splitmix64(seed);
+            uint64_t v = splitmix64(seed);
+            for (int k = 0; k < rounds; ++k)
             {
-                creates_third_side = true;
+                uint64_t more_h = splitmix64(seed);
+                uint64_t more_v = splitmix64(seed);
+                h = sparse ? h & more_h : h | more_h;
+                v = sparse ? v & more_v : v | more_v;
             }
-            if (!creates_third_side && move.r > 0 && count_sides(move.r - 1, move.c) == 3)
+            lines.row[i] = (uint32_t)h & h_mask;
+            if (i < rows - 1)
             {
-                creates_third_side = true;
+                lines.row[V_BASE + i] = (uint32_t)v & v_mask;
             }
         }
-        else
+        SideMasks scalar = {};
+        SideMasks vector = {};
+        side_masks_scalar(lines, rows - 1, box_mask, scalar, 0);
+        side_masks_avx2(lines, rows - 1, box_mask, vector, 0);
+        for (int k = 0; k < 5; ++k)
         {
-            if (move.c < columns - 1 && count_sides(move.r, move.c) == 3)
-            {
-                creates_third_side = true;
-            }
-            if (!creates_third_side && move.c > 0 && count_sides(move.r, move.c - 1) == 3)
+            if (!std::equal(scalar.count[k], scalar.count[k] + rows - 1, vector.count[k]))
             {
-                creates_third_side = true;
+                failed++;
+                std::cerr << "board " << board << " on " << board_size << "x" << board_size << ": "
+                          << k << " sided boxes differ" << std::endl;
+                break;
             }
         }
-        undo_move(move);
-        bot_score = temp_bot_score;
-        if (boxed > 0)
-        {
-            return move;
-        }
-        if (!creates_third_side)
-        {
-            safe_moves.push_back(move);
-        }
-
-    }
-
-    
-    // for (const Move& move : available_moves)
-    // {
-    //     apply_move(move);
-    //     bool creates_third_side = false;
-    //     if (move.type == HORIZONTAL)
-    //     {
-    //         if (move.r < rows - 1 && count_sides(move.r, move.c) == 3)
-    //         {
-    //             creates_third_side = true;
-    //         }
-    //         if (!creates_third_side && move.r > 0 && count_sides(move.r - 1, move.c) == 3)
-    //         {
-    //             creates_third_side = true;
-    //         }
-    //     }
-    //     else
-    //     {
-    //         if (move.c < columns - 1 && count_sides(move.r, move.c) == 3)
-    //         {
-    //             creates_third_side = true;
-    //         }
-    //         if (!creates_third_side && move.c > 0 && count_sides(move.r, move.c - 1) == 3)
-    //         {
-    //             creates_third_side = true;
-    //         }
-    //     }
-    //     undo_move(move);
-    //     if (!creates_third_side)
-    //     {
-    //         safe_moves.push_back(move);
-    //     }
-    // }
-    if (!safe_moves.empty())
-    {
-        return safe_moves[0];
-    }
-
-    int depth = 4;
-    Move best_move = available_moves[0];
-    double best_score = -100000;
-    double alpha = -100000;
-    double beta = 100000;
-
-    for (const Move& move : available_moves)
-    {
-        int boxed = apply_move(move);
-        double eval = (boxed > 0) ? minimax(depth - 1, alpha, beta, true) : minimax(depth - 1, alpha, beta, false);
-        undo_move(move);
-        if (eval > best_score)
-        {
-            best_score = eval;
-            best_move = move;
-        }
-        alpha = std::max(alpha, eval);
     }
-    return best_move;
+    return failed;
+#else
+    (void)board_size;
+    (void)boards;
+    (void)seed;
+    return -1;
+#endif
 }
 
-string translate(const Move& move)
+// command line options, also used for the two sides of a self play game
+// false, with a message on std::cerr, when an argument isn't an option or a value isn't one it takes
+bool parse_options(const std::vector<std::string>& args, EngineConfig& options)
 {
-    const int total_box_rows = rows - 1;
-    string box_name;
-    string side_char;
-
-    if (move.type == HORIZONTAL)
+    for (size_t i = 0; i < args.size(); ++i)
     {
-        if (move.r < total_box_rows)
+        const std::string& arg = args[i];
+        bool has_value = i + 1 < args.size();
+        if (arg == "--hash" && has_value)
         {
-            box_name = string(1, 'A' + move.c) + to_string(total_box_rows - move.r);
-            side_char = "T";
+            // transposition table size in MB
+            options.hash_mb = std::stoul(args[++i]);
         }
-        else
+        else if (arg == "--move-time" && has_value)
         {
-            box_name = string(1, 'A' + move.c) + to_string(total_box_rows - (move.r - 1));
-            side_char = "B";
+            // search budget per move in milliseconds
+            options.move_time_ms = std::stoll(args[++i]);
         }
-    }
-    else
-    {
-        const int total_box_cols = columns - 1;
-        if (move.c < total_box_cols)
+        else if (arg == "--threads" && has_value)
         {
-            box_name = string(1, 'A' + move.c) + to_string(total_box_rows - move.r);
-            side_char = "L";
+            // search threads, all sharing the transposition table
+            options.threads = std::max(1, std::stoi(args[++i]));
         }
-        else
+        else if (arg == "--game-time" && has_value)
         {
-            box_name = string(1, 'A' + (move.c - 1)) + to_string(total_box_rows - move.r);
-            side_char = "R";
+            // optional clock for all of our moves in the game, in milliseconds
+            options.game_time_ms = std::stoll(args[++i]);
         }
-    }
-    return box_name + " " + side_char;
-}
-
-void parse_turn_input()
-{
-    std::cin >> bot_score >> opp_score;
-    std::cin.ignore();
-    int num_boxes;
-    std::cin >> num_boxes;
-    std::cin.ignore();
-
-    for (int r = 0; r < rows; ++r)
-    {
-        for (int c = 0; c < columns - 1; ++c)
+        else if (arg == "--batch")
         {
-            horizontal_lines[r][c] = true;
+            // analyse the positions on stdin, see run_batch()
+            options.batch = true;
         }
-    }
-    for (int r = 0; r < rows - 1; ++r)
-    {
-        for (int c = 0; c < columns; ++c)
+        else if (arg == "--depth" && has_value)
         {
-            vertical_lines[r][c] = true;
+            // fixed search depth, the move time still applies
+            options.depth_limit = std::stoi(args[++i]);
         }
-    }
-
-    for (int i = 0; i < num_boxes; i++)
-    {
-        std::string box_name, sides_str;
-        std::cin >> box_name >> sides_str;
-        std::cin.ignore();
-        int box_c = box_name[0] - 'A';
-        int box_r = (rows - 1) - std::stoi(box_name.substr(1));
-        for (char side : sides_str)
+        else if (arg == "--eval" && has_value)
         {
-            if (side == 'T')
-            {
-                horizontal_lines[box_r][box_c] = false;
-            }
-            else if (side == 'B')
+            // leaf evaluation: v5 (default) or final
+            const std::string& eval = args[++i];
+            if (eval != "v5" && eval != "final")
             {
-                horizontal_lines[box_r + 1][box_c] = false;
+                std::cerr << "unknown eval " << eval << std::endl;
+                return false;
             }
-            else if (side == 'L')
-            {
-                vertical_lines[box_r][box_c] = false;
-            }
-            else if (side == 'R')
+            options.eval = (eval == "final") ? EVAL_FINAL : EVAL_V5;
+        }
+        else if (arg == "--engine" && has_value)
+        {
+            // alphabeta (default) or mcts
+            const std::string& engine = args[++i];
+            if (engine != "alphabeta" && engine != "mcts")
             {
-                vertical_lines[box_r][box_c + 1] = false;
+                std::cerr << "unknown engine " << engine << std::endl;
+                return false;
             }
+            options.engine = (engine == "mcts") ? ENGINE_MCTS : ENGINE_ALPHABETA;
+        }
+        else if (arg == "--telemetry")
+        {
+            // per move search statistics on stderr
+            options.telemetry = true;
+        }
+        else if (arg == "--book" && has_value)
+        {
+            // opening book built by bench/book.cpp for this board size
+            options.book = args[++i];
+        }
+        else if (arg == "--tablebase" && has_value)
+        {
+            // chain and loop values built by bench/tablebase.cpp
+            options.tablebase = args[++i];
+        }
+        else if (arg == "--no-quiescence")
+        {
+            // score the leaves as they are, captures pending or not
+            options.quiescence = false;
+        }
+        else if (arg == "--ponder")
+        {
+            // search on the opponent's time, sharing the table with our own search
+            options.ponder = true;
+        }
+        else
+        {
+            std::cerr << "unknown option " << arg << std::endl;
+            return false;
         }
     }
+    return true;
 }
 
-int main()
+#ifndef DOTS_NO_MAIN
+int main(int argc, char* argv[])
 {
     ios_base::sync_with_stdio(false);
     cin.tie(NULL);
 
+    std::unique_ptr<SearchContext> ctx(new SearchContext);
+    if (!parse_options(std::vector<std::string>(argv + 1, argv + argc), ctx->config))
+    {
+        return 1;
+    }
+
     int board_size;
     std::cin >> board_size;
     std::cin.ignore();
-    std::string player_id;
-    std::cin >> player_id;
-    std::cin.ignore();
+    if (!ctx->config.batch)
+    {
+        std::string player_id;
+        std::cin >> player_id;
+        std::cin.ignore();
+    }
 
     int dim = board_size;
     rows = dim + 1;
     columns = dim + 1;
 
     default_arr();
+    init_zobrist();
+    if (!ctx->config.book.empty() && !book_load(ctx->config.book))
+    {
+        std::cerr << "no usable opening book in " << ctx->config.book << std::endl;
+    }
+    if (!ctx->config.tablebase.empty() && !tablebase_load(ctx->config.tablebase))
+    {
+        std::cerr << "no usable tablebase in " << ctx->config.tablebase << std::endl;
+    }
+    if (ctx->config.batch)
+    {
+        run_batch(ctx->config);
+        return 0;
+    }
+    if (ctx->config.engine != ENGINE_MCTS)
+    {
+        // mcts never probes the table, its tree gets the --hash memory instead
+        tt_resize(main_table, ctx->config.hash_mb);
+    }
 
-    while (true)
+    std::unique_ptr<SearchContext> ponder;
+    std::thread ponder_thread;
+    for (int move_number = 1; parse_turn_input(ctx->board); ++move_number)
     {
-        parse_turn_input();
-        Move best_move = winning_move();
+        ctx->ponder_depth = stop_ponder(ponder, ponder_thread);
+        Clock::time_point start = Clock::now();
+        Move best_move = winning_move(*ctx);
+        long long elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+        ctx->game_time_used += elapsed;
         std::string output_move = translate(best_move);
         std::cout << output_move << std::endl;
+        if (ctx->config.telemetry)
+        {
+            report_telemetry(*ctx, move_number, output_move, elapsed);
+        }
+
+        // our own line goes onto the board now, so the next input only adds the opponent's
+        int edge = move_edge(best_move);
+        if (has_line(ctx->board, edge))
+        {
+            continue;
+        }
+        ctx->board.turn = AI;
+        bool again = apply_move(ctx->board, edge) > 0;
+        if (ctx->config.ponder && !again)
+        {
+            start_ponder(*ctx, ponder, ponder_thread);
+        }
     }
+    stop_ponder(ponder, ponder_thread);
     return 0;
 }
-
+#endif